@@ -1,5 +1,7 @@
 out vec4 frag_color;
 in vec2 tex_coord;
+flat in vec4 glyph_subrect;
+flat in vec4 glyph_color;
 
 uniform vec4 d_rect;
 uniform float border_size;
@@ -197,6 +199,11 @@ vec4 corners(vec2 tc) {
 	return texture(texture_sampler, vec2(xout, yout) / border_size);
 }
 
+//layout(index = 27) subroutine(font_function_class)
+vec4 glyph_instance(vec2 tc) {
+	return vec4(glyph_color.rgb, glyph_color.a * texture(texture_sampler, vec2(tc.x * glyph_subrect.y + glyph_subrect.x, tc.y * glyph_subrect.a + glyph_subrect.z)).r);
+}
+
 //layout(index = 18) subroutine(font_function_class)
 vec4 transparent_color(vec2 tc) {
 	return vec4(inner_color, 0.5);
@@ -260,6 +267,7 @@ case 23: return stripchart(tc);
 case 24: return triangle_strip(tc);
 case 25: return fixed_size_repeat_border(tc);
 case 26: return corners(tc);
+case 27: return glyph_instance(tc);
 default: break;
 	}
 	return vec4(0.f, 0.f, 1.f, 1.f);
@@ -1,6 +1,12 @@
 layout (location = 0) in vec2 vertex_position; //0
 layout (location = 1) in vec2 v_tex_coord; //1
+// per instance values, only read when drawing glyph instances
+layout (location = 2) in vec4 instance_rect; // takes the place of d_rect
+layout (location = 3) in vec4 instance_subrect; // where the glyph is in its atlas
+layout (location = 4) in vec4 instance_color;
 out vec2 tex_coord;
+flat out vec4 glyph_subrect;
+flat out vec4 glyph_color;
 
 uniform float screen_width;
 uniform float screen_height;
@@ -10,13 +16,17 @@ uniform float screen_height;
 // d_rect.z - width
 // d_rect.w - height
 uniform vec4 d_rect;
+uniform uint glyph_instances;
 
 void main() {
-	// Transform the d_rect rectangle to screen space coordinates
+	vec4 rect = glyph_instances != 0u ? instance_rect : d_rect;
+	// Transform the rectangle to screen space coordinates
 	// vertex_position is used to flip and/or rotate the coordinates
 	gl_Position = vec4(
-		-1.0 + (2.0 * ((vertex_position.x * d_rect.z)  + d_rect.x) / screen_width),
-		 1.0 - (2.0 * ((vertex_position.y * d_rect.w)  + d_rect.y) / screen_height),
+		-1.0 + (2.0 * ((vertex_position.x * rect.z)  + rect.x) / screen_width),
+		 1.0 - (2.0 * ((vertex_position.y * rect.w)  + rect.y) / screen_height),
 		0.0, 1.0);
 	tex_coord = v_tex_coord;
+	glyph_subrect = instance_subrect;
+	glyph_color = instance_color;
 }
@@ -688,6 +688,7 @@ inline constexpr uint32_t stripchart = 23;
 inline constexpr uint32_t triangle_strip = 24;
 inline constexpr uint32_t border_repeat = 25;
 inline constexpr uint32_t corner_repeat = 26;
+inline constexpr uint32_t glyph_instance = 27;
 } // namespace parameters
 }
 
@@ -22,6 +22,10 @@ enum class text_color : uint8_t {
 enum class alignment : uint8_t {
 	left, right, center
 };
+// drawn under the glyphs of a chunk, in the same draw call as the glyphs themselves
+enum class text_effect : uint8_t {
+	none, shadow, outline
+};
 }
 
 namespace ui{
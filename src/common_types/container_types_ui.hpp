@@ -19,6 +19,21 @@ struct text_mouse_test_result {
 	uint32_t quadrent;
 };
 
+// groups of game data that ui elements can declare they read. whatever changes the game state records the groups
+// it touched, and the following ui update only visits elements depending on one of them
+enum class update_channel : uint8_t {
+	game_tick,  // data advanced by the game tick
+	commands,   // data changed by executing player commands
+	selection,  // what the player has selected
+	shown,      // only set when an element is placed or made visible, for elements that read nothing but ui state
+	count
+};
+using update_channels = uint64_t;
+constexpr update_channels all_update_channels = ~update_channels(0);
+constexpr update_channels channel_bit(update_channel c) {
+	return update_channels(1) << uint8_t(c);
+}
+
 }
 
 
@@ -39,5 +54,14 @@ struct mouse_probe {
 	element_base* under_mouse;
 	xy_pair relative_location;
 };
+// the results for the click and tooltip probes, filled in by a single traversal of the element tree
+struct mouse_probe_set {
+	mouse_probe click;
+	mouse_probe tooltip;
+
+	bool complete() const {
+		return click.under_mouse && tooltip.under_mouse;
+	}
+};
 
 }
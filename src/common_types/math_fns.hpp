@@ -1,5 +1,25 @@
 #pragma once
 #include <cmath>
+#include <span>
+#include <immintrin.h>
+
+// the lane versions below reproduce the scalar functions bit for bit, which only holds if the compiler does not fuse
+// multiplies and adds into fma instructions. clang can be told so per function. gcc can't, so the build passes it
+// -ffp-contract=off, and msvc only fuses them under /fp:contract or /fp:fast
+#if defined(__FAST_MATH__)
+#error "math_fns.hpp can't be built with -ffast-math"
+#elif defined(__clang__)
+#define MATH_NO_FP_CONTRACT _Pragma("clang fp contract(off)")
+#elif defined(__GNUC__)
+#define MATH_NO_FP_CONTRACT
+#elif defined(_MSC_VER)
+#if defined(_M_FP_CONTRACT) || defined(_M_FP_FAST)
+#error "math_fns.hpp can't be built with /fp:contract or /fp:fast"
+#endif
+#define MATH_NO_FP_CONTRACT
+#else
+#error "math_fns.hpp doesn't know how to keep this compiler from fusing floating point operations"
+#endif
 
 namespace math {
 
@@ -16,6 +36,7 @@ inline constexpr float internal_check(float x, float err, float lower, float upp
 }
 
 inline float sin(float x) noexcept {
+	MATH_NO_FP_CONTRACT
 	// based on
 	// https://web.archive.org/web/20200628195036/http://mooooo.ooo/chebyshev-sine-approximation/
 	x = fmod(x, 2.f * pi);
@@ -47,11 +68,13 @@ inline float sin(float x) noexcept {
 }
 
 inline float cos(float x) noexcept {
+	MATH_NO_FP_CONTRACT
 	float r = math::sin(pi / 2.f - x);
 	return internal_check(r, 0.0016f, -1.f, 1.f);
 }
 
 inline float acos(float x) noexcept {
+	MATH_NO_FP_CONTRACT
 	// Lagrange polynomial - https://stackoverflow.com/questions/3380628/fast-arc-cos-algorithm
 	// Maximum absolute error of 0.017
 	constexpr float acos_input_err = 0.001f;
@@ -69,6 +92,7 @@ inline float acos(float x) noexcept {
 }
 
 inline float sqrt(float x) noexcept {
+	MATH_NO_FP_CONTRACT
 	union {
 		float f;
 		int i;
@@ -79,4 +103,230 @@ inline float sqrt(float x) noexcept {
 	return u.f * x;
 }
 
+// lane versions of the functions above, four floats at a time with sse2 and eight with avx2. each lane gives exactly
+// what the scalar function gives for it. the input checks are not repeated, so out of range inputs are clamped the
+// same way the scalar functions clamp them in release builds
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define MATH_HAS_LANES4
+#endif
+#if defined(__AVX2__)
+#define MATH_HAS_LANES8
+#endif
+
+namespace detail {
+
+// sin reduces its argument with fmod, which is exact. the lanes reproduce it in double precision, which is exact as
+// long as the quotient stays below this many multiples of 2 pi; larger or non finite lanes go through the scalar code
+inline constexpr float fmod_lanes_limit = 268435456.f * 2.f * pi;
+
+#ifdef MATH_HAS_LANES4
+struct lanes4 {
+	using v = __m128;
+	static constexpr int width = 4;
+
+	static v load(float const* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, v a) { _mm_storeu_ps(p, a); }
+	static v set1(float x) { return _mm_set1_ps(x); }
+	static v add(v a, v b) { return _mm_add_ps(a, b); }
+	static v sub(v a, v b) { return _mm_sub_ps(a, b); }
+	static v mul(v a, v b) { return _mm_mul_ps(a, b); }
+	static v div(v a, v b) { return _mm_div_ps(a, b); }
+	static v lt(v a, v b) { return _mm_cmplt_ps(a, b); }
+	static v gt(v a, v b) { return _mm_cmpgt_ps(a, b); }
+	static v le(v a, v b) { return _mm_cmple_ps(a, b); }
+	static v ge(v a, v b) { return _mm_cmpge_ps(a, b); }
+	static v select(v mask, v if_true, v if_false) { return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false)); }
+	static bool all(v mask) { return _mm_movemask_ps(mask) == 0xF; }
+	static v abs(v a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	static v with_sign_of(v magnitude, v sign) { return _mm_or_ps(abs(magnitude), _mm_and_ps(_mm_set1_ps(-0.f), sign)); }
+	static v rsqrt_seed(v a) { return _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f375a86), _mm_srai_epi32(_mm_castps_si128(a), 1))); }
+
+	static __m128d fmod_half(__m128d x, __m128d y) {
+		auto q = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_div_pd(x, y)));
+		auto r = _mm_sub_pd(x, _mm_mul_pd(q, y));
+		// the rounded division can land the quotient one off when x / y is within rounding of an integer
+		auto signed_y = _mm_or_pd(y, _mm_and_pd(_mm_set1_pd(-0.0), x));
+		auto abs_r = _mm_andnot_pd(_mm_set1_pd(-0.0), r);
+		r = _mm_sub_pd(r, _mm_and_pd(_mm_cmpge_pd(abs_r, y), signed_y));
+		auto zero = _mm_setzero_pd();
+		auto flipped = _mm_or_pd(_mm_and_pd(_mm_cmpgt_pd(x, zero), _mm_cmplt_pd(r, zero)), _mm_and_pd(_mm_cmplt_pd(x, zero), _mm_cmpgt_pd(r, zero)));
+		return _mm_add_pd(r, _mm_and_pd(flipped, signed_y));
+	}
+	static v fmod(v x, float y) {
+		auto yd = _mm_set1_pd(double(y));
+		auto lo = _mm_cvtpd_ps(fmod_half(_mm_cvtps_pd(x), yd));
+		auto hi = _mm_cvtpd_ps(fmod_half(_mm_cvtps_pd(_mm_movehl_ps(x, x)), yd));
+		return with_sign_of(_mm_movelh_ps(lo, hi), x);
+	}
+};
+#endif
+
+#ifdef MATH_HAS_LANES8
+struct lanes8 {
+	using v = __m256;
+	static constexpr int width = 8;
+
+	static v load(float const* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, v a) { _mm256_storeu_ps(p, a); }
+	static v set1(float x) { return _mm256_set1_ps(x); }
+	static v add(v a, v b) { return _mm256_add_ps(a, b); }
+	static v sub(v a, v b) { return _mm256_sub_ps(a, b); }
+	static v mul(v a, v b) { return _mm256_mul_ps(a, b); }
+	static v div(v a, v b) { return _mm256_div_ps(a, b); }
+	static v lt(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static v gt(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static v le(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static v ge(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static v select(v mask, v if_true, v if_false) { return _mm256_blendv_ps(if_false, if_true, mask); }
+	static bool all(v mask) { return _mm256_movemask_ps(mask) == 0xFF; }
+	static v abs(v a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+	static v with_sign_of(v magnitude, v sign) { return _mm256_or_ps(abs(magnitude), _mm256_and_ps(_mm256_set1_ps(-0.f), sign)); }
+	static v rsqrt_seed(v a) { return _mm256_castsi256_ps(_mm256_sub_epi32(_mm256_set1_epi32(0x5f375a86), _mm256_srai_epi32(_mm256_castps_si256(a), 1))); }
+
+	static __m256d fmod_half(__m256d x, __m256d y) {
+		auto q = _mm256_round_pd(_mm256_div_pd(x, y), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+		auto r = _mm256_sub_pd(x, _mm256_mul_pd(q, y));
+		// the rounded division can land the quotient one off when x / y is within rounding of an integer
+		auto signed_y = _mm256_or_pd(y, _mm256_and_pd(_mm256_set1_pd(-0.0), x));
+		auto abs_r = _mm256_andnot_pd(_mm256_set1_pd(-0.0), r);
+		r = _mm256_sub_pd(r, _mm256_and_pd(_mm256_cmp_pd(abs_r, y, _CMP_GE_OQ), signed_y));
+		auto zero = _mm256_setzero_pd();
+		auto flipped = _mm256_or_pd(
+			_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), _mm256_cmp_pd(r, zero, _CMP_LT_OQ)),
+			_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_LT_OQ), _mm256_cmp_pd(r, zero, _CMP_GT_OQ)));
+		return _mm256_add_pd(r, _mm256_and_pd(flipped, signed_y));
+	}
+	static v fmod(v x, float y) {
+		auto yd = _mm256_set1_pd(double(y));
+		auto lo = _mm256_cvtpd_ps(fmod_half(_mm256_cvtps_pd(_mm256_castps256_ps128(x)), yd));
+		auto hi = _mm256_cvtpd_ps(fmod_half(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)), yd));
+		return with_sign_of(_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1), x);
+	}
+};
+#endif
+
+template<typename L, typename F>
+typename L::v lanes_by_scalar(typename L::v x, F&& f) {
+	alignas(32) float values[L::width];
+	L::store(values, x);
+	for(auto& e : values)
+		e = f(e);
+	return L::load(values);
+}
+
+template<typename L>
+typename L::v clamp_lanes(typename L::v x, float lower, float upper) {
+	// the same comparisons as internal_check, so that nan lanes stay nan
+	return L::select(L::lt(x, L::set1(lower)), L::set1(lower), L::select(L::gt(x, L::set1(upper)), L::set1(upper), x));
+}
+
+template<typename L>
+typename L::v sin_lanes(typename L::v x) {
+	if(!L::all(L::lt(L::abs(x), L::set1(fmod_lanes_limit))))
+		return lanes_by_scalar<L>(x, [](float e) { return math::sin(e); });
+
+	x = L::fmod(x, 2.f * pi);
+	x = L::select(L::lt(x, L::set1(-pi)), L::add(x, L::set1(2.f * pi)), L::select(L::gt(x, L::set1(pi)), L::sub(x, L::set1(2.f * pi)), x));
+
+	auto x2 = L::mul(x, x);
+	auto p11 = L::set1(0.00000000013291342f);
+	auto p9 = L::add(L::mul(p11, x2), L::set1(-0.000000023317787f));
+	auto p7 = L::add(L::mul(p9, x2), L::set1(0.0000025222919f));
+	auto p5 = L::add(L::mul(p7, x2), L::set1(-0.00017350505f));
+	auto p3 = L::add(L::mul(p5, x2), L::set1(0.0066208798f));
+	auto p1 = L::add(L::mul(p3, x2), L::set1(-0.10132118f));
+	auto pi_major = L::set1(3.1415927f);
+	auto pi_minor = L::set1(-0.00000008742278f);
+	auto r = L::mul(L::mul(L::mul(L::sub(L::sub(x, pi_major), pi_minor), L::add(L::add(x, pi_major), pi_minor)), p1), x);
+	return clamp_lanes<L>(r, -1.f, 1.f);
+}
+
+template<typename L>
+typename L::v cos_lanes(typename L::v x) {
+	return clamp_lanes<L>(sin_lanes<L>(L::sub(L::set1(pi / 2.f), x)), -1.f, 1.f);
+}
+
+template<typename L>
+typename L::v acos_lanes(typename L::v x) {
+	auto x_cubed_term = L::mul(L::mul(L::mul(L::set1(0.4643653210307f), x), x), x);
+	auto x_squared_term = L::mul(L::mul(L::set1(0.921784152891457f), x), x);
+	auto numerator = L::sub(L::sub(L::add(x_cubed_term, x_squared_term), L::mul(L::set1(2.0178302343512f), x)), L::set1(0.939115566365855f));
+	numerator = L::add(L::mul(numerator, x), L::set1(1.5707963267949f));
+	auto denominator = L::add(L::mul(L::sub(L::mul(L::mul(L::set1(0.295624144969963f), x), x), L::set1(1.28459062446908f)), L::mul(x, x)), L::set1(1.f));
+	auto r = clamp_lanes<L>(L::div(numerator, denominator), 0.f, pi);
+	return L::select(L::ge(x, L::set1(1.f)), L::set1(0.f), L::select(L::le(x, L::set1(-1.f)), L::set1(pi), r));
+}
+
+template<typename L>
+typename L::v sqrt_lanes(typename L::v x) {
+	auto u = L::rsqrt_seed(x);
+	auto half_x = L::mul(L::set1(0.5f), x);
+	u = L::mul(u, L::sub(L::set1(1.5f), L::mul(L::mul(half_x, u), u)));
+	u = L::mul(u, L::sub(L::set1(1.5f), L::mul(L::mul(half_x, u), u)));
+	return L::mul(u, x);
+}
+
+// out[i] = f(in[i]), eight lanes at a time where possible, then four, then one
+template<typename F>
+void for_each_lane(std::span<float const> in, std::span<float> out, F&& f) noexcept {
+	assert(out.size() >= in.size());
+	size_t i = 0;
+#ifdef MATH_HAS_LANES8
+	for(; i + 8 <= in.size(); i += 8)
+		lanes8::store(out.data() + i, f(lanes8::load(in.data() + i)));
+#endif
+#ifdef MATH_HAS_LANES4
+	for(; i + 4 <= in.size(); i += 4)
+		lanes4::store(out.data() + i, f(lanes4::load(in.data() + i)));
+#endif
+	for(; i < in.size(); ++i)
+		out[i] = f(in[i]);
+}
+
+} // namespace detail
+
+#ifdef MATH_HAS_LANES4
+inline __m128 sin(__m128 x) noexcept {
+	return detail::sin_lanes<detail::lanes4>(x);
+}
+inline __m128 cos(__m128 x) noexcept {
+	return detail::cos_lanes<detail::lanes4>(x);
+}
+inline __m128 acos(__m128 x) noexcept {
+	return detail::acos_lanes<detail::lanes4>(x);
+}
+inline __m128 sqrt(__m128 x) noexcept {
+	return detail::sqrt_lanes<detail::lanes4>(x);
+}
+#endif
+#ifdef MATH_HAS_LANES8
+inline __m256 sin(__m256 x) noexcept {
+	return detail::sin_lanes<detail::lanes8>(x);
+}
+inline __m256 cos(__m256 x) noexcept {
+	return detail::cos_lanes<detail::lanes8>(x);
+}
+inline __m256 acos(__m256 x) noexcept {
+	return detail::acos_lanes<detail::lanes8>(x);
+}
+inline __m256 sqrt(__m256 x) noexcept {
+	return detail::sqrt_lanes<detail::lanes8>(x);
+}
+#endif
+
+// whole arrays, such as the values of a float property for a range of objects. out must be at least as long as in
+inline void sin(std::span<float const> in, std::span<float> out) noexcept {
+	detail::for_each_lane(in, out, [](auto v) { return math::sin(v); });
+}
+inline void cos(std::span<float const> in, std::span<float> out) noexcept {
+	detail::for_each_lane(in, out, [](auto v) { return math::cos(v); });
+}
+inline void acos(std::span<float const> in, std::span<float> out) noexcept {
+	detail::for_each_lane(in, out, [](auto v) { return math::acos(v); });
+}
+inline void sqrt(std::span<float const> in, std::span<float> out) noexcept {
+	detail::for_each_lane(in, out, [](auto v) { return math::sqrt(v); });
+}
+
 }
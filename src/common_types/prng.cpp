@@ -2,6 +2,7 @@
 #include "system_state.hpp"
 
 #include "random123/philox.h"
+#include <immintrin.h>
 
 namespace rng {
 
@@ -43,4 +44,133 @@ float get_random_float(sys::state const& state, uint32_t value_in_hi, uint32_t v
 	return pattern.f - 1.0f;
 }
 
+namespace {
+
+constexpr uint32_t key_hi = 0x3918CA23;
+
+// philox4x32-10 for several counters at once, one counter per 32 bit lane. c0 holds the value_in_hi of each lane,
+// the rest of the counter is the shared value_in_lo and zeros, as in get_random
+#if defined(__AVX2__)
+struct philox_lanes {
+	using v = __m256i;
+	static constexpr uint32_t width = 8;
+	static v set1(uint32_t x) { return _mm256_set1_epi32(int32_t(x)); }
+	static v first(uint32_t x) { return _mm256_add_epi32(_mm256_set1_epi32(int32_t(x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)); }
+	static v bxor(v a, v b) { return _mm256_xor_si256(a, b); }
+	static void mulhilo(v m, v a, v& hi, v& lo) {
+		auto even = _mm256_mul_epu32(a, m);
+		auto odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+		lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+		hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+	}
+	static void store(uint32_t* out, v a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), a); }
+};
+#define RNG_HAS_PHILOX_LANES
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+struct philox_lanes {
+	using v = __m128i;
+	static constexpr uint32_t width = 4;
+	static v set1(uint32_t x) { return _mm_set1_epi32(int32_t(x)); }
+	static v first(uint32_t x) { return _mm_add_epi32(_mm_set1_epi32(int32_t(x)), _mm_setr_epi32(0, 1, 2, 3)); }
+	static v bxor(v a, v b) { return _mm_xor_si128(a, b); }
+	static void mulhilo(v m, v a, v& hi, v& lo) {
+		auto even = _mm_mul_epu32(a, m);
+		auto odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+		auto low_words = _mm_set1_epi64x(0xFFFFFFFF);
+		lo = _mm_or_si128(_mm_and_si128(even, low_words), _mm_slli_epi64(odd, 32));
+		hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(low_words, odd));
+	}
+	static void store(uint32_t* out, v a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), a); }
+};
+#define RNG_HAS_PHILOX_LANES
+#endif
+
+#ifdef RNG_HAS_PHILOX_LANES
+// r[word][lane] receives the four output words of each lane's block
+void philox_block(uint32_t seed, uint32_t value_in_hi_first, uint32_t value_in_lo, uint32_t (&r)[4][philox_lanes::width]) {
+	using L = philox_lanes;
+	auto m0 = L::set1(PHILOX_M4x32_0);
+	auto m1 = L::set1(PHILOX_M4x32_1);
+
+	L::v c0 = L::first(value_in_hi_first);
+	L::v c1 = L::set1(value_in_lo);
+	L::v c2 = L::set1(0);
+	L::v c3 = L::set1(0);
+	uint32_t k0 = seed;
+	uint32_t k1 = key_hi;
+
+	for(uint32_t round = 0; round < 10; ++round) {
+		if(round != 0) {
+			k0 += PHILOX_W32_0;
+			k1 += PHILOX_W32_1;
+		}
+		L::v hi0, lo0, hi1, lo1;
+		L::mulhilo(m0, c0, hi0, lo0);
+		L::mulhilo(m1, c2, hi1, lo1);
+		c0 = L::bxor(L::bxor(hi1, c1), L::set1(k0));
+		c1 = lo1;
+		c2 = L::bxor(L::bxor(hi0, c3), L::set1(k1));
+		c3 = lo0;
+	}
+
+	L::store(r[0], c0);
+	L::store(r[1], c1);
+	L::store(r[2], c2);
+	L::store(r[3], c3);
+}
+#endif
+
+r123::Philox4x32::ctr_type philox_single(uint32_t seed, uint32_t value_in_hi, uint32_t value_in_lo) {
+	r123::Philox4x32 rng;
+	r123::Philox4x32::ctr_type c = { value_in_hi, value_in_lo, 0, 0 };
+	r123::Philox4x32::key_type k = { seed, key_hi };
+	return rng(c, k);
+}
+
+// calls out(i, r0, r1, r2, r3) with the block for value_in_hi_first + i, for every i below count
+template<typename F>
+void for_each_block(uint32_t seed, uint32_t value_in_hi_first, uint32_t value_in_lo, size_t count, F&& out) {
+	size_t i = 0;
+#ifdef RNG_HAS_PHILOX_LANES
+	alignas(32) uint32_t r[4][philox_lanes::width];
+	for(; i + philox_lanes::width <= count; i += philox_lanes::width) {
+		philox_block(seed, uint32_t(value_in_hi_first + i), value_in_lo, r);
+		for(uint32_t j = 0; j < philox_lanes::width; ++j)
+			out(i + j, r[0][j], r[1][j], r[2][j], r[3][j]);
+	}
+#endif
+	for(; i < count; ++i) {
+		auto r = philox_single(seed, uint32_t(value_in_hi_first + i), value_in_lo);
+		out(i, r[0], r[1], r[2], r[3]);
+	}
+}
+
+float float_from_bits(uint32_t bits) {
+	union {
+		uint32_t u;
+		float f;
+	} pattern;
+	pattern.u = 0x3f800000;
+	pattern.u |= 0x7fffff & bits;
+	return pattern.f - 1.0f;
+}
+
+} // namespace
+
+void get_random_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<uint64_t> out) {
+	for_each_block(state.game_seed, value_in_hi_first, value_in_lo, out.size(), [&](size_t i, uint32_t r0, uint32_t r1, uint32_t, uint32_t) {
+		out[i] = (uint64_t(r0) << 32) | uint64_t(r1);
+	});
+}
+void get_random_pair_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<random_pair> out) {
+	for_each_block(state.game_seed, value_in_hi_first, value_in_lo, out.size(), [&](size_t i, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3) {
+		out[i] = random_pair{ (uint64_t(r0) << 32) | uint64_t(r1), (uint64_t(r2) << 32) | uint64_t(r3) };
+	});
+}
+void get_random_float_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<float> out) {
+	for_each_block(state.game_seed, value_in_hi_first, value_in_lo, out.size(), [&](size_t i, uint32_t, uint32_t r1, uint32_t, uint32_t) {
+		out[i] = float_from_bits(r1);
+	});
+}
+
 } // namespace rng
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
+
 namespace sys {
 struct state;
 }
@@ -14,5 +17,12 @@ struct random_pair {
 uint64_t get_random(sys::state const& state, uint32_t value_in_hi, uint32_t value_in_lo);
 random_pair get_random_pair(sys::state const& state, uint32_t value_in_hi, uint32_t value_in_lo);
 uint32_t reduce(uint32_t value_in, uint32_t upper_bound);
+float get_random_float(sys::state const& state, uint32_t value_in_hi, uint32_t value_in_lo);
+
+// out[i] receives exactly what the single value functions return for value_in_hi_first + i, so that a range of
+// entity indexes can be drawn for at once. several counters are run in parallel in simd lanes where available
+void get_random_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<uint64_t> out);
+void get_random_pair_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<random_pair> out);
+void get_random_float_batch(sys::state const& state, uint32_t value_in_hi_first, uint32_t value_in_lo, std::span<float> out);
 
 } // namespace rng
@@ -66,7 +66,7 @@ void execute_pending_commands(sys::state& state) {
 	}
 
 	if(command_executed) {
-		state.game_state_updated.store(true, std::memory_order::release);
+		state.signal_game_state_updated(sys::channel_bit(sys::update_channel::commands));
 	}
 }
 
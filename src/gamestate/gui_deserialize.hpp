@@ -92,10 +92,15 @@ inline void bytes_to_windows(char const* bytes, size_t size, std::string const&
 
 		auto essential_window_section = window_section.read_section(); // essential section
 
-		std::string name;
-		essential_window_section.read(name);
-		if(name != ".TABLE")
-			map.insert_or_assign(project_name + "::" + name, sys::aui_pending_bytes{ bytes + window_offset, window_size });
+		auto name = essential_window_section.read<std::string_view>();
+		if(name != ".TABLE") {
+			std::string key;
+			key.reserve(project_name.length() + 2 + name.length());
+			key += project_name;
+			key += "::";
+			key += name;
+			map.insert_or_assign(std::move(key), sys::aui_pending_bytes{ bytes + window_offset, window_size });
+		}
 	}
 }
 
@@ -20,15 +20,18 @@ namespace sys {
 //
 
 void state::on_rbutton_down(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
 	game_scene::on_rbutton_down(*this, x, y, mod);
 }
 
 void state::on_mbutton_down(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
 	// Lose focus on text
 	ui_state.set_focus_target(*this, nullptr);
 }
 
 void state::on_lbutton_down(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
 	if(ui_state.current_drag_and_drop_data_type != ui::drag_and_drop_data::none) {
 		if(!current_scene.get_root)
 			return;
@@ -51,14 +54,18 @@ void state::on_lbutton_down(int32_t x, int32_t y, key_modifiers mod) {
 	
 }
 
-void state::on_rbutton_up(int32_t x, int32_t y, key_modifiers mod) { }
+void state::on_rbutton_up(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
+}
 void state::on_mbutton_up(int32_t x, int32_t y, key_modifiers mod) {
-	
+	ui_redraw_requested = true;
 }
 void state::on_lbutton_up(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
 	game_scene::on_lbutton_up(*this, x, y, mod);
 }
 void state::on_mouse_move(int32_t x, int32_t y, key_modifiers mod) {
+	ui_redraw_requested = true;
 	
 	if(ui_state.under_mouse != nullptr) {
 		auto r = ui_state.under_mouse->impl_on_mouse_move(*this, ui_state.relative_mouse_location.x,
@@ -80,6 +87,7 @@ void state::on_mouse_move(int32_t x, int32_t y, key_modifiers mod) {
 	}
 }
 void state::on_mouse_drag(int32_t x, int32_t y, key_modifiers mod) { // called when the left button is held down
+	ui_redraw_requested = true;
 	is_dragging = true;
 	if(ui_state.drag_target) {
 		ui_state.drag_target->on_drag(*this, int32_t(mouse_x_position / user_settings.ui_scale),
@@ -88,12 +96,14 @@ void state::on_mouse_drag(int32_t x, int32_t y, key_modifiers mod) { // called w
 	}
 }
 void state::on_drag_finished(int32_t x, int32_t y, key_modifiers mod) { // called when the left button is released after one or more drag events
+	ui_redraw_requested = true;
 	if(ui_state.drag_target) {
 		ui_state.drag_target->on_drag_finish(*this);
 		ui_state.drag_target = nullptr;
 	}
 }
 void state::on_resize(int32_t x, int32_t y, window::window_state win_state) {
+	ui_redraw_requested = true;
 	if(win_state != window::window_state::minimized) {
 		ui_state.for_each_root([&](ui::element_base& elm) {
 			elm.base_data.size.x = int16_t(x / user_settings.ui_scale);
@@ -104,6 +114,7 @@ void state::on_resize(int32_t x, int32_t y, window::window_state win_state) {
 
 
 void state::on_key_down(virtual_key keycode, key_modifiers mod) {
+	ui_redraw_requested = true;
 	if(keycode == virtual_key::CONTROL)
 		ui_state.ctrl_held_down = true;
 	if(keycode == virtual_key::SHIFT || keycode == virtual_key::LSHIFT || keycode == virtual_key::RSHIFT)
@@ -117,6 +128,7 @@ void state::on_key_down(virtual_key keycode, key_modifiers mod) {
 }
 
 void state::on_key_up(virtual_key keycode, key_modifiers mod) {
+	ui_redraw_requested = true;
 	if(keycode == virtual_key::CONTROL)
 		ui_state.ctrl_held_down = false;
 	if(keycode == virtual_key::SHIFT || keycode == virtual_key::LSHIFT || keycode == virtual_key::RSHIFT)
@@ -124,6 +136,7 @@ void state::on_key_up(virtual_key keycode, key_modifiers mod) {
 
 }
 void state::on_text(char32_t c) { // c is win1250 codepage value
+	ui_redraw_requested = true;
 	if(ui_state.edit_target_internal)
 		ui_state.edit_target_internal->on_text(*this, c);
 }
@@ -133,10 +146,12 @@ bool state::filter_tso_mouse_events(int32_t x, int32_t y, uint32_t buttons) {
 	return false;
 }
 void state::pass_edit_command(ui::edit_command command, sys::key_modifiers mod) {
+	ui_redraw_requested = true;
 	if(ui_state.edit_target_internal)
 		ui_state.edit_target_internal->on_edit_command(*this, command, mod);
 }
 bool state::send_edit_mouse_move(int32_t x, int32_t y, bool extend_selection) {
+	ui_redraw_requested = true;
 	if(ui_state.edit_target_internal) {
 		auto abs_pos = ui::get_absolute_location(*this, *ui_state.edit_target_internal);
 		auto posx = int32_t(x / user_settings.ui_scale);
@@ -203,6 +218,15 @@ void state::render() { // called to render the frame may (and should) delay retu
 
 
 	auto game_state_was_updated = game_state_updated.exchange(false, std::memory_order::acq_rel);
+	// read after the flag: channels recorded in between are kept for the next update instead of being lost
+	auto changed_channels = game_state_was_updated ? changed_update_channels.exchange(0, std::memory_order::acq_rel) : update_channels(0);
+
+	ui_redraw_requested = false;
+	auto frame_start = std::chrono::steady_clock::now();
+	ui_state.time_since_last_render = std::chrono::duration_cast<std::chrono::microseconds>(frame_start - ui_state.last_render_time);
+	ui_state.last_render_time = frame_start;
+	ui_state.last_frame_layout_passes = std::exchange(ui_state.layout_passes, 0);
+	ui_state.last_frame_layout_time = std::exchange(ui_state.layout_time, std::chrono::microseconds{ 0 });
 
 	if(game_state_was_updated) {
 		//
@@ -213,10 +237,15 @@ void state::render() { // called to render the frame may (and should) delay retu
 	root_elm->base_data.size.x = ui_state.root->base_data.size.x;
 	root_elm->base_data.size.y = ui_state.root->base_data.size.y;
 
-	auto mouse_probe = root_elm->impl_probe_mouse(*this, int32_t(mouse_x_position / user_settings.ui_scale),
-		int32_t(mouse_y_position / user_settings.ui_scale), ui::mouse_probe_type::click);
-	auto tooltip_probe = root_elm->impl_probe_mouse(*this, int32_t(mouse_x_position / user_settings.ui_scale),
-		int32_t(mouse_y_position / user_settings.ui_scale), ui::mouse_probe_type::tooltip);
+	auto const probe_x = int32_t(mouse_x_position / user_settings.ui_scale);
+	auto const probe_y = int32_t(mouse_y_position / user_settings.ui_scale);
+	ui::mouse_probe_set probes{
+		ui::mouse_probe{ nullptr, ui::xy_pair{ int16_t(probe_x), int16_t(probe_y) } },
+		ui::mouse_probe{ nullptr, ui::xy_pair{ int16_t(probe_x), int16_t(probe_y) } }
+	};
+	root_elm->impl_probe_mouse_combined(*this, probe_x, probe_y, probes);
+	auto mouse_probe = probes.click;
+	auto tooltip_probe = probes.tooltip;
 
 	if(!mouse_probe.under_mouse) {
 		mouse_probe = current_scene.recalculate_mouse_probe(*this, mouse_probe, tooltip_probe);
@@ -236,7 +265,10 @@ void state::render() { // called to render the frame may (and should) delay retu
 	}
 
 	if(game_state_was_updated) {
+		// an update signaled without naming what changed refreshes everything
+		ui_state.active_update_channels = changed_channels != 0 ? changed_channels : all_update_channels;
 		root_elm->impl_on_update(*this);
+		ui_state.active_update_channels = all_update_channels;
 		current_scene.on_game_state_update(*this);
 		ui_state.update_tooltip(*this, tooltip_probe, tooltip_sub_index, int16_t(root_elm->base_data.size.y - 20));
 	} // END game state was updated
@@ -245,11 +277,29 @@ void state::render() { // called to render the frame may (and should) delay retu
 	ui_state.reposition_tooltip(tooltip_bounds, root_elm->base_data.size.y, root_elm->base_data.size.x);
 
 	if(ui_state.under_mouse != mouse_probe.under_mouse) {
-		if(ui_state.under_mouse)
+		if(ui_state.under_mouse) {
 			ui_state.under_mouse->on_hover_end(*this);
+			ui::invalidate_render_cache(*ui_state.under_mouse);
+		}
+		ui_state.hover_fading_out = ui_state.under_mouse;
 		ui_state.under_mouse = mouse_probe.under_mouse;
-		if(ui_state.under_mouse)
+		if(ui_state.under_mouse) {
 			ui_state.under_mouse->on_hover(*this);
+			ui::invalidate_render_cache(*ui_state.under_mouse);
+		}
+		ui_state.hover_transition_end = frame_start + std::chrono::milliseconds(alice_ui::mouse_over_animation_ms);
+		ui_state.hover_transition_running = true;
+	} else if(ui_state.hover_transition_running) {
+		// the fades are drawn from the time alone, so any cache holding them has to be redrawn until they finish
+		if(ui_state.under_mouse)
+			ui::invalidate_render_cache(*ui_state.under_mouse);
+		if(ui_state.hover_fading_out)
+			ui::invalidate_render_cache(*ui_state.hover_fading_out);
+		if(frame_start >= ui_state.hover_transition_end) {
+			// this frame draws the fades finished
+			ui_state.hover_transition_running = false;
+			ui_state.hover_fading_out = nullptr;
+		}
 	}
 
 	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
@@ -302,6 +352,31 @@ void state::render() { // called to render the frame may (and should) delay retu
 	//	}
 	//}
 
+	ogl::end_texture_frame(*this);
+}
+
+// the edit cursor fades in and out continuously, so a focused text box keeps frames coming at this interval
+constexpr int32_t edit_cursor_frame_ms = 33;
+// even with nothing to draw the window loop wakes up this often, so that the music keeps advancing
+constexpr double idle_wait_seconds = 0.25;
+
+bool state::ui_frame_due() {
+	if(!user_settings.on_demand_rendering || ui_redraw_requested)
+		return true;
+	if(game_state_updated.load(std::memory_order::acquire) || ui_animation.is_running() || ui_state.hover_transition_running)
+		return true;
+	if(ui_state.edit_target_internal && window::cursor_blink_ms() > 0)
+		return std::chrono::steady_clock::now() - ui_state.last_render_time >= std::chrono::milliseconds(edit_cursor_frame_ms);
+	return false;
+}
+
+double state::ui_idle_wait_seconds() const {
+	if(ui_state.edit_target_internal && window::cursor_blink_ms() > 0) {
+		auto next_frame = ui_state.last_render_time + std::chrono::milliseconds(edit_cursor_frame_ms);
+		auto remaining = std::chrono::duration<double>(next_frame - std::chrono::steady_clock::now()).count();
+		return std::clamp(remaining, 0.0, idle_wait_seconds);
+	}
+	return idle_wait_seconds;
 }
 
 void state::on_create() {
@@ -317,8 +392,25 @@ void state::on_create() {
 	auto uitemplates = simple_fs::open_file(assets, NATIVE("the.tui"));
 	if(uitemplates) {
 		auto content = view_contents(*uitemplates);
-		serialization::in_buffer buffer(content.data, content.file_size);
-		ui_templates = template_project::bytes_to_project(buffer);
+		auto source_hash = ankerl::unordered_dense::detail::wyhash::hash(content.data, content.file_size);
+
+		// the compiled image is used in place from the mapped file; it is rebuilt whenever the.tui changes
+		auto settings_location = simple_fs::get_or_create_settings_directory();
+		auto image_file = simple_fs::open_file(settings_location, NATIVE("the.tui.image"));
+		auto image_content = image_file ? view_contents(*image_file) : simple_fs::file_contents{ };
+		if(image_file && template_project::project_image_is_current(image_content.data, image_content.file_size, source_hash)) {
+			ui_templates = template_project::image_to_project(image_content.data, image_content.file_size);
+			ui_state.held_open_ui_files.emplace_back(std::move(*image_file));
+		} else {
+			// the stale image has to be closed first, or it can't be overwritten on windows
+			image_content = simple_fs::file_contents{ };
+			image_file.reset();
+			serialization::in_buffer buffer(content.data, content.file_size);
+			auto image = template_project::bytes_to_project_image(buffer, source_hash);
+			simple_fs::write_file(settings_location, NATIVE("the.tui.image"), image.data(), uint32_t(image.size()));
+			ui_templates = template_project::image_to_project(image.data(), image.size());
+			ui_templates.owned_image = std::move(image);
+		}
 		ui_templates.svg_directory.pop_back();
 		svg_image_files.root_directory = simple_fs::utf16_to_native(ui_templates.svg_directory);
 		auto svgdir = simple_fs::open_directory(assets, simple_fs::utf16_to_native(ui_templates.svg_directory));
@@ -356,17 +448,8 @@ void state::on_create() {
 //
 
 std::string_view state::to_string_view(dcon::text_key tag) const {
-	if(!tag)
-		return std::string_view();
-	assert(size_t(tag.index()) < key_data.size());
-	auto start_position = key_data.data() + tag.index();
-	auto data_size = key_data.size();
-	auto end_position = start_position;
-	for(; end_position < key_data.data() + data_size; ++end_position) {
-		if(*end_position == 0)
-			break;
-	}
-	return std::string_view(key_data.data() + tag.index(), size_t(end_position - start_position));
+	assert(!tag || size_t(tag.index()) < key_data.size());
+	return text::key_string(key_data, tag);
 }
 
 std::string_view state::locale_string_view(uint32_t tag) const {
@@ -384,6 +467,8 @@ std::string_view state::locale_string_view(uint32_t tag) const {
 void state::reset_locale_pool() {
 	locale_text_data.clear();
 	locale_key_to_text_sequence.clear();
+	locale_template_tokens.clear();
+	locale_templates.clear();
 	locale_text_data.push_back(0);
 }
 
@@ -392,12 +477,27 @@ void state::load_locale_strings(std::string_view locale_name) {
 	auto assets_dir = open_directory(root_dir, NATIVE("assets/localization"));
 
 	auto locale_dir = open_directory(assets_dir, simple_fs::utf8_to_native(locale_name));
+
+	// the sources are only hashed here; they are parsed only if the compiled cache is missing or out of date
+	std::vector<simple_fs::file> sources;
+	uint64_t source_hash = 0;
 	for(auto& file : list_files(locale_dir, NATIVE(".csv"))) {
 		if(auto ofile = open_file(file); ofile) {
 			auto content = view_contents(*ofile);
-			text::consume_csv_file(*this, content.data, content.file_size, 1);
+			source_hash = text::locale_source_hash(source_hash, simple_fs::native_to_utf8(get_file_name(file)), content.data, content.file_size);
+			sources.push_back(std::move(*ofile));
 		}
 	}
+
+	if(text::load_locale_cache(*this, locale_name, source_hash))
+		return;
+
+	text::locale_cache_builder cache;
+	std::vector<simple_fs::file_contents> contents;
+	for(auto& f : sources)
+		contents.push_back(view_contents(f));
+	text::consume_csv_files(*this, contents, 1, &cache);
+	text::save_locale_cache(*this, locale_name, source_hash, cache);
 }
 
 bool state::key_is_localized(dcon::text_key tag) const {
@@ -420,16 +520,22 @@ dcon::text_key state::add_key_utf8(std::string const& new_text) {
 	return add_key_utf8(std::string_view(new_text.data()));
 }
 dcon::text_key state::add_key_utf8(std::string_view new_text) {
-	auto ekey = lookup_key(new_text);
-	if(ekey)
-		return ekey;
+	return add_key_utf8(text::hashed_key{ new_text, text::detail::ci_wyhash(new_text.data(), new_text.size()) });
+}
+dcon::text_key state::add_key_utf8(text::hashed_key new_key) {
+	if(auto it = untrans_key_to_text_sequence.find(new_key); it != untrans_key_to_text_sequence.end())
+		return *it;
 
-	auto start = key_data.size();
-	auto length = new_text.length();
+	auto length = new_key.text.length();
 	if(length == 0)
 		return dcon::text_key();
+	auto header = key_data.size();
+	auto start = header + text::key_header_size;
 	key_data.resize(start + length + 1, char(0));
-	std::copy_n(new_text.data(), length, key_data.data() + start);
+	auto length32 = uint32_t(length);
+	std::memcpy(key_data.data() + header, &length32, sizeof(uint32_t));
+	std::memcpy(key_data.data() + header + sizeof(uint32_t), &new_key.hash, sizeof(uint64_t));
+	std::copy_n(new_key.text.data(), length, key_data.data() + start);
 	key_data.back() = 0;
 
 	auto ret = dcon::text_key(dcon::text_key::value_base_t(start));
@@ -666,6 +772,8 @@ void state::save_user_settings() const {
 	US_SAVE(zoom_speed);
 	US_SAVE(mute_on_focus_lost);
 	US_SAVE(locale);
+	US_SAVE(texture_budget_mb);
+	US_SAVE(on_demand_rendering);
 #undef US_SAVE
 
 	simple_fs::write_file(settings_location, NATIVE("user_settings.dat"), &buffer[0], uint32_t(ptr - buffer));
@@ -694,6 +802,8 @@ void state::load_user_settings() {
 			US_LOAD(zoom_speed);
 			US_LOAD(mute_on_focus_lost);
 			US_LOAD(locale);
+			US_LOAD(texture_budget_mb);
+			US_LOAD(on_demand_rendering);
 #undef US_LOAD
 		} while(false);
 
@@ -774,11 +884,19 @@ void state::update_ui_scale(float new_scale) {
 	}
 	//font_collection.reset_fonts();
 
+	text::shaping_batch batch;
+	ui_state.for_each_root([&](ui::element_base& elm) {
+		elm.impl_on_queue_text_shaping(*this, batch);
+	});
+	batch.shape_all(*this);
+
+	font_collection.prepared_shapes = &batch;
 	ui_state.for_each_root([&](ui::element_base& elm) {
 		elm.impl_on_reset_text(*this);
 	});
+	font_collection.prepared_shapes = nullptr;
 
-	game_state_updated.store(true, std::memory_order::release); //update ui
+	signal_game_state_updated(); //update ui
 
 	// TODO move windows
 }
@@ -791,6 +909,12 @@ void state::single_game_tick() {
 	// do business
 
 	tick_end_counter.fetch_add(1, std::memory_order::seq_cst);
+	signal_game_state_updated(channel_bit(update_channel::game_tick));
+	window::wake_ui_loop(*this);
+}
+
+void state::signal_game_state_updated(update_channels changed) {
+	changed_update_channels.fetch_or(changed, std::memory_order::acq_rel);
 	game_state_updated.store(true, std::memory_order::release);
 }
 
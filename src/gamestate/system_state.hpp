@@ -38,6 +38,8 @@ struct user_settings_s {
 	float zoom_speed = 20.f;
 	bool mute_on_focus_lost = true;
 	char locale[16] = "en-US";
+	uint32_t texture_budget_mb = 256; // 0 = never evict late loaded textures
+	bool on_demand_rendering = true; // only draw frames when something has changed
 };
 
 struct alignas(64) state {
@@ -48,6 +50,8 @@ struct alignas(64) state {
 	std::vector<char> locale_text_data;
 	ankerl::unordered_dense::set<dcon::text_key, text::vector_backed_ci_hash, text::vector_backed_ci_eq> untrans_key_to_text_sequence;
 	ankerl::unordered_dense::map<dcon::text_key, uint32_t, text::vector_backed_ci_hash, text::vector_backed_ci_eq> locale_key_to_text_sequence;
+	std::vector<text::template_token> locale_template_tokens;
+	ankerl::unordered_dense::map<uint32_t, text::template_range> locale_templates; // from an offset into locale_text_data
 
 #ifdef USE_LLVM
 	std::unique_ptr<fif::environment> jit_environment;
@@ -81,6 +85,7 @@ struct alignas(64) state {
 
 	// synchronization data (between main update logic and ui thread)
 	std::atomic<bool> game_state_updated = false;                    // game state -> ui signal
+	std::atomic<update_channels> changed_update_channels = 0;        // game state -> ui: what changed since the last ui update
 	std::atomic<int32_t> actual_game_speed = 0;                      // ui -> game state message
 	std::atomic<bool> quit_signaled = false;                         // ui -> game state signal
 	rigtorp::SPSCQueue<command::command_data> incoming_commands;          // ui or network -> local gamestate
@@ -100,6 +105,7 @@ struct alignas(64) state {
 	bool drag_selecting = false;
 	int32_t mouse_x_position = 0;
 	int32_t mouse_y_position = 0;
+	bool ui_redraw_requested = true; // set by input and window events, cleared when a frame is drawn
 	bool is_dragging = false;
 	int32_t x_drag_start = 0;
 	int32_t y_drag_start = 0;
@@ -137,7 +143,10 @@ struct alignas(64) state {
 	bool send_edit_mouse_move(int32_t x, int32_t y, bool extend_selection);
 	text_mouse_test_result detailed_text_mouse_test(int32_t x, int32_t y);
 	void render(); // called to render the frame may (and should) delay returning until the frame is rendered, including waiting for vsync
+	bool ui_frame_due(); // whether the window loop has to draw a frame now
+	double ui_idle_wait_seconds() const; // how long the window loop may block on events when no frame is due
 
+	void signal_game_state_updated(update_channels changed = all_update_channels); // may be called from any thread
 	void single_game_tick();
 	// this function runs the internal logic of the game. It will return *only* after a quit notification is sent to it
 	void game_loop();
@@ -154,6 +163,7 @@ struct alignas(64) state {
 
 	dcon::text_key add_key_utf8(std::string const& text);
 	dcon::text_key add_key_utf8(std::string_view text);
+	dcon::text_key add_key_utf8(text::hashed_key key);
 	uint32_t add_locale_data_utf8(std::string const& text);
 	uint32_t add_locale_data_utf8(std::string_view text);
 
@@ -17,7 +17,7 @@ enum class aui_text_alignment : uint8_t {
 };
 
 struct background_definition {
-	std::string file_name;
+	std::string_view file_name; // points into the project image
 
 	int32_t base_x = 1000;
 	int32_t base_y = 1000;
@@ -27,7 +27,7 @@ struct background_definition {
 };
 
 struct icon_definition {
-	std::string file_name;
+	std::string_view file_name; // points into the project image
 
 	// not to save -- rendering info
 	asvg::simple_svg renders;
@@ -211,6 +211,67 @@ struct drop_down_template {
 	bool animate_active_transition = false;
 };
 
+// a compiled project is a single relocatable block: a header of {offset, count} pairs followed by the raw template
+// arrays, a string area, and a perfect hash index for each kind of named resource. it contains no pointers,
+// so it can be used straight out of a mapped file or out of the buffer it was built in
+
+constexpr uint32_t project_image_magic = 0x49495541; // 'AUII'
+constexpr uint32_t project_image_version = 1;
+
+struct image_array {
+	uint32_t offset = 0;
+	uint32_t count = 0;
+};
+struct image_name_slot {
+	uint32_t name_offset = 0;
+	uint32_t name_length = 0;
+	int32_t value = -1;
+};
+struct image_name_index {
+	image_array seeds; // one per bucket
+	image_array slots;
+};
+struct project_image_header {
+	uint32_t magic = project_image_magic;
+	uint32_t version = project_image_version;
+	uint64_t layout_signature = 0;
+	uint64_t source_hash = 0;
+	uint32_t image_size = 0;
+	uint32_t padding = 0;
+
+	image_array svg_directory; // char16_t
+	image_array label_t;
+	image_array button_t;
+	image_array progress_bar_t;
+	image_array window_t;
+	image_array iconic_button_t;
+	image_array layout_region_t;
+	image_array mixed_button_t;
+	image_array toggle_button_t;
+	image_array table_t;
+	image_array stacked_bar_t;
+	image_array drop_down_t;
+	image_array colors;
+	image_array icons; // image_name_slot per icon, in index order
+	image_array backgrounds; // image_name_slot per background, in index order
+	image_array background_sizes; // base_x, base_y pairs
+
+	image_name_index icons_by_name;
+	image_name_index colors_by_name;
+	image_name_index backgrounds_by_name;
+};
+
+// read only view of one of the image's perfect hash indices
+struct name_index {
+	char const* base = nullptr;
+	uint32_t const* seeds = nullptr;
+	image_name_slot const* slots = nullptr;
+	uint32_t bucket_count = 0;
+	uint32_t slot_count = 0;
+
+	int32_t find(std::string_view name) const;
+};
+
 struct project {
 	std::u16string svg_directory;
 	std::vector<label_template> label_t;
@@ -228,30 +289,27 @@ struct project {
 	std::vector< icon_definition> icons;
 	std::vector<color_definition> colors;
 
-	ankerl::unordered_dense::map<std::string, int32_t> icons_by_name;
-	ankerl::unordered_dense::map<std::string, int32_t> colors_by_name;
-	ankerl::unordered_dense::map<std::string, int32_t> backgrounds_by_name;
+	std::vector<char> owned_image; // empty when the image is mapped from disk instead
+	name_index icons_by_name;
+	name_index colors_by_name;
+	name_index backgrounds_by_name;
 };
 
 inline int32_t icon_by_name(project const& p, std::string_view name) {
-	if(auto it = p.icons_by_name.find(std::string(name)); it != p.icons_by_name.end()) {
-		return it->second;
-	}
-	return -1;
+	return p.icons_by_name.find(name);
 }
 inline int32_t color_by_name(project const& p, std::string_view name) {
-	if(auto it = p.colors_by_name.find(std::string(name)); it != p.colors_by_name.end()) {
-		return it->second;
-	}
-	return -1;
+	return p.colors_by_name.find(name);
 }
 inline int32_t background_by_name(project const& p, std::string_view name) {
-	if(auto it = p.backgrounds_by_name.find(std::string(name)); it != p.backgrounds_by_name.end()) {
-		return it->second;
-	}
-	return -1;
+	return p.backgrounds_by_name.find(name);
 }
 
+// parses the editor's .tui format into a compiled image
+std::vector<char> bytes_to_project_image(serialization::in_buffer& buffer, uint64_t source_hash);
+bool project_image_is_current(char const* data, size_t size, uint64_t source_hash);
+// the returned project refers to the image memory, which must outlive it
+project image_to_project(char const* data, size_t size);
 project bytes_to_project(serialization::in_buffer& buffer);
 
 }
@@ -1,11 +1,18 @@
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include "uitemplate.hpp"
 #include "stools.hpp"
 
 namespace template_project {
 
-project bytes_to_project(serialization::in_buffer& buffer) {
-	project result;
+namespace {
+
+struct source_names {
+	std::vector<std::string_view> colors;
+};
+
+void parse_project_source(serialization::in_buffer& buffer, project& result, source_names& names) {
 	auto header_section = buffer.read_section();
 	header_section.read(result.svg_directory);
 
@@ -15,9 +22,7 @@ project bytes_to_project(serialization::in_buffer& buffer) {
 		while(colors_section) {
 			result.colors.emplace_back();
 			auto individual_color = colors_section.read_section();
-			std::string name_string;
-			individual_color.read(name_string);
-			result.colors_by_name.insert_or_assign(name_string, int32_t(result.colors.size() - 1));
+			names.colors.push_back(individual_color.read<std::string_view>());
 			individual_color.read(result.colors.back().r);
 			individual_color.read(result.colors.back().g);
 			individual_color.read(result.colors.back().b);
@@ -28,18 +33,16 @@ project bytes_to_project(serialization::in_buffer& buffer) {
 		while(icons_section) {
 			result.icons.emplace_back();
 			auto indv_icon = icons_section.read_section();
-			indv_icon.read(result.icons.back().file_name);
-			result.icons_by_name.insert_or_assign(result.icons.back().file_name, int32_t(result.icons.size() - 1));
+			result.icons.back().file_name = indv_icon.read<std::string_view>();
 		}
 
 		auto bg_section = buffer.read_section();
 		while(bg_section) {
 			result.backgrounds.emplace_back();
 			auto indv_bg = bg_section.read_section();
-			indv_bg.read(result.backgrounds.back().file_name);
+			result.backgrounds.back().file_name = indv_bg.read<std::string_view>();
 			indv_bg.read(result.backgrounds.back().base_x);
 			indv_bg.read(result.backgrounds.back().base_y);
-			result.backgrounds_by_name.insert_or_assign(result.backgrounds.back().file_name, int32_t(result.backgrounds.size() - 1));
 		}
 
 		auto labels_section = buffer.read_section();
@@ -305,6 +308,277 @@ project bytes_to_project(serialization::in_buffer& buffer) {
 			indv_tb.read(i.animate_active_transition);
 			indv_tb.read(i.vertical_nudge);
 		}
+}
+
+uint64_t layout_signature() {
+	uint64_t sizes[] = {
+		sizeof(label_template), sizeof(button_template), sizeof(progress_bar_template), sizeof(window_template),
+		sizeof(iconic_button_template), sizeof(layout_region_template), sizeof(mixed_template), sizeof(toggle_button_template),
+		sizeof(table_template), sizeof(stacked_bar_template), sizeof(drop_down_template), sizeof(color_definition),
+		sizeof(image_name_slot), sizeof(project_image_header)
+	};
+	return ankerl::unordered_dense::detail::wyhash::hash(sizes, sizeof(sizes));
+}
+
+uint64_t name_hash(std::string_view name) {
+	return ankerl::unordered_dense::detail::wyhash::hash(name.data(), name.length());
+}
+uint32_t slot_for(uint64_t h, uint32_t seed, uint32_t slot_count) {
+	return uint32_t(ankerl::unordered_dense::detail::wyhash::mix(h, uint64_t(seed) * 0x9E3779B97F4A7C15ull) % slot_count);
+}
+
+class image_writer {
+public:
+	std::vector<char> data;
+
+	uint32_t align() {
+		while(data.size() % 8 != 0)
+			data.push_back(0);
+		return uint32_t(data.size());
+	}
+	template<typename T>
+	image_array write_array(T const* values, size_t count) {
+		image_array r{ align(), uint32_t(count) };
+		data.resize(data.size() + sizeof(T) * count);
+		if(count > 0)
+			std::memcpy(data.data() + r.offset, values, sizeof(T) * count);
+		return r;
+	}
+	template<typename T>
+	image_array write_array(std::vector<T> const& values) {
+		return write_array(values.data(), values.size());
+	}
+	image_name_slot write_name(std::string_view name) {
+		image_name_slot r{ uint32_t(data.size()), uint32_t(name.length()), -1 };
+		data.insert(data.end(), name.begin(), name.end());
+		return r;
+	}
+};
+
+// hash and displace: names are grouped into buckets by their hash, and each bucket gets a seed that sends
+// all of its members to unused slots. lookups are then one seed read and one slot read
+image_name_index write_name_index(image_writer& w, std::vector<image_name_slot> entries) {
+	// later definitions of the same name replace earlier ones
+	{
+		ankerl::unordered_dense::map<std::string_view, size_t> last;
+		for(size_t i = 0; i < entries.size(); ++i)
+			last.insert_or_assign(std::string_view(w.data.data() + entries[i].name_offset, entries[i].name_length), i);
+		std::vector<image_name_slot> unique;
+		for(auto& [name, i] : last)
+			unique.push_back(entries[i]);
+		entries = std::move(unique);
+	}
+
+	image_name_index result;
+	if(entries.empty())
+		return result;
+
+	auto const bucket_count = uint32_t(std::max(size_t(1), entries.size() / 4));
+	auto slot_count = uint32_t(entries.size());
+
+	std::vector<uint64_t> hashes;
+	for(auto& e : entries)
+		hashes.push_back(name_hash(std::string_view(w.data.data() + e.name_offset, e.name_length)));
+
+	std::vector<std::vector<uint32_t>> buckets(bucket_count);
+	for(uint32_t i = 0; i < uint32_t(entries.size()); ++i)
+		buckets[hashes[i] % bucket_count].push_back(i);
+	std::vector<uint32_t> bucket_order(bucket_count);
+	for(uint32_t i = 0; i < bucket_count; ++i)
+		bucket_order[i] = i;
+	std::stable_sort(bucket_order.begin(), bucket_order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+	std::vector<uint32_t> seeds;
+	std::vector<image_name_slot> slots;
+	while(true) {
+		seeds.assign(bucket_count, 0);
+		slots.assign(slot_count, image_name_slot{ });
+		std::vector<bool> taken(slot_count, false);
+		bool success = true;
+
+		for(auto b : bucket_order) {
+			if(buckets[b].empty())
+				continue;
+			bool placed = false;
+			for(uint32_t seed = 1; seed < (1 << 16) && !placed; ++seed) {
+				placed = true;
+				for(size_t j = 0; j < buckets[b].size() && placed; ++j) {
+					auto s = slot_for(hashes[buckets[b][j]], seed, slot_count);
+					if(taken[s])
+						placed = false;
+					for(size_t k = 0; k < j && placed; ++k) {
+						if(slot_for(hashes[buckets[b][k]], seed, slot_count) == s)
+							placed = false;
+					}
+				}
+				if(placed) {
+					seeds[b] = seed;
+					for(auto i : buckets[b]) {
+						auto s = slot_for(hashes[i], seed, slot_count);
+						taken[s] = true;
+						slots[s] = entries[i];
+					}
+				}
+			}
+			if(!placed) {
+				success = false;
+				break;
+			}
+		}
+		if(success)
+			break;
+		slot_count += slot_count / 8 + 1; // give the search some slack and try again
+	}
+
+	result.seeds = w.write_array(seeds);
+	result.slots = w.write_array(slots);
+	return result;
+}
+
+template<typename T>
+void read_array(std::vector<T>& out, char const* data, image_array a) {
+	out.resize(a.count);
+	if(a.count > 0)
+		std::memcpy(out.data(), data + a.offset, sizeof(T) * a.count);
+}
+
+name_index read_name_index(char const* data, image_name_index const& i) {
+	name_index r;
+	r.base = data;
+	r.seeds = reinterpret_cast<uint32_t const*>(data + i.seeds.offset);
+	r.bucket_count = i.seeds.count;
+	r.slots = reinterpret_cast<image_name_slot const*>(data + i.slots.offset);
+	r.slot_count = i.slots.count;
+	return r;
+}
+
+}
+
+int32_t name_index::find(std::string_view name) const {
+	if(slot_count == 0 || bucket_count == 0)
+		return -1;
+	auto h = name_hash(name);
+	auto& slot = slots[slot_for(h, seeds[h % bucket_count], slot_count)];
+	if(slot.value >= 0 && std::string_view(base + slot.name_offset, slot.name_length) == name)
+		return slot.value;
+	return -1;
+}
+
+std::vector<char> bytes_to_project_image(serialization::in_buffer& buffer, uint64_t source_hash) {
+	project source;
+	source_names names;
+	parse_project_source(buffer, source, names);
+
+	image_writer w;
+	w.data.resize(sizeof(project_image_header));
+	project_image_header header;
+	header.layout_signature = layout_signature();
+	header.source_hash = source_hash;
+
+	header.svg_directory = w.write_array(source.svg_directory.data(), source.svg_directory.size());
+	header.label_t = w.write_array(source.label_t);
+	header.button_t = w.write_array(source.button_t);
+	header.progress_bar_t = w.write_array(source.progress_bar_t);
+	header.window_t = w.write_array(source.window_t);
+	header.iconic_button_t = w.write_array(source.iconic_button_t);
+	header.layout_region_t = w.write_array(source.layout_region_t);
+	header.mixed_button_t = w.write_array(source.mixed_button_t);
+	header.toggle_button_t = w.write_array(source.toggle_button_t);
+	header.table_t = w.write_array(source.table_t);
+	header.stacked_bar_t = w.write_array(source.stacked_bar_t);
+	header.drop_down_t = w.write_array(source.drop_down_t);
+	header.colors = w.write_array(source.colors);
+
+	std::vector<image_name_slot> icon_names;
+	for(int32_t i = 0; i < int32_t(source.icons.size()); ++i) {
+		icon_names.push_back(w.write_name(source.icons[i].file_name));
+		icon_names.back().value = i;
+	}
+	std::vector<image_name_slot> bg_names;
+	std::vector<int32_t> bg_sizes;
+	for(int32_t i = 0; i < int32_t(source.backgrounds.size()); ++i) {
+		bg_names.push_back(w.write_name(source.backgrounds[i].file_name));
+		bg_names.back().value = i;
+		bg_sizes.push_back(source.backgrounds[i].base_x);
+		bg_sizes.push_back(source.backgrounds[i].base_y);
+	}
+	std::vector<image_name_slot> color_names;
+	for(int32_t i = 0; i < int32_t(names.colors.size()); ++i) {
+		color_names.push_back(w.write_name(names.colors[i]));
+		color_names.back().value = i;
+	}
+
+	header.icons = w.write_array(icon_names);
+	header.backgrounds = w.write_array(bg_names);
+	header.background_sizes = w.write_array(bg_sizes);
+	header.icons_by_name = write_name_index(w, icon_names);
+	header.colors_by_name = write_name_index(w, color_names);
+	header.backgrounds_by_name = write_name_index(w, bg_names);
+
+	w.align();
+	header.image_size = uint32_t(w.data.size());
+	std::memcpy(w.data.data(), &header, sizeof(project_image_header));
+	return std::move(w.data);
+}
+
+bool project_image_is_current(char const* data, size_t size, uint64_t source_hash) {
+	if(size < sizeof(project_image_header))
+		return false;
+	project_image_header header;
+	std::memcpy(&header, data, sizeof(project_image_header));
+	return header.magic == project_image_magic
+		&& header.version == project_image_version
+		&& header.layout_signature == layout_signature()
+		&& header.source_hash == source_hash
+		&& header.image_size == size;
+}
+
+project image_to_project(char const* data, size_t size) {
+	project result;
+	project_image_header header;
+	std::memcpy(&header, data, sizeof(project_image_header));
+	assert(header.image_size <= size);
+
+	auto svg_dir = reinterpret_cast<char16_t const*>(data + header.svg_directory.offset);
+	result.svg_directory = std::u16string(svg_dir, svg_dir + header.svg_directory.count);
+
+	read_array(result.label_t, data, header.label_t);
+	read_array(result.button_t, data, header.button_t);
+	read_array(result.progress_bar_t, data, header.progress_bar_t);
+	read_array(result.window_t, data, header.window_t);
+	read_array(result.iconic_button_t, data, header.iconic_button_t);
+	read_array(result.layout_region_t, data, header.layout_region_t);
+	read_array(result.mixed_button_t, data, header.mixed_button_t);
+	read_array(result.toggle_button_t, data, header.toggle_button_t);
+	read_array(result.table_t, data, header.table_t);
+	read_array(result.stacked_bar_t, data, header.stacked_bar_t);
+	read_array(result.drop_down_t, data, header.drop_down_t);
+	read_array(result.colors, data, header.colors);
+
+	auto icon_names = reinterpret_cast<image_name_slot const*>(data + header.icons.offset);
+	result.icons.resize(header.icons.count);
+	for(uint32_t i = 0; i < header.icons.count; ++i)
+		result.icons[i].file_name = std::string_view(data + icon_names[i].name_offset, icon_names[i].name_length);
+
+	auto bg_names = reinterpret_cast<image_name_slot const*>(data + header.backgrounds.offset);
+	auto bg_sizes = reinterpret_cast<int32_t const*>(data + header.background_sizes.offset);
+	result.backgrounds.resize(header.backgrounds.count);
+	for(uint32_t i = 0; i < header.backgrounds.count; ++i) {
+		result.backgrounds[i].file_name = std::string_view(data + bg_names[i].name_offset, bg_names[i].name_length);
+		result.backgrounds[i].base_x = bg_sizes[i * 2];
+		result.backgrounds[i].base_y = bg_sizes[i * 2 + 1];
+	}
+
+	result.icons_by_name = read_name_index(data, header.icons_by_name);
+	result.colors_by_name = read_name_index(data, header.colors_by_name);
+	result.backgrounds_by_name = read_name_index(data, header.backgrounds_by_name);
+	return result;
+}
+
+project bytes_to_project(serialization::in_buffer& buffer) {
+	auto image = bytes_to_project_image(buffer, 0);
+	auto result = image_to_project(image.data(), image.size());
+	result.owned_image = std::move(image); // moving the vector keeps its buffer, so the views stay valid
 	return result;
 }
 
@@ -4,6 +4,7 @@
 namespace sys {
 
 void on_mouse_wheel(sys::state& state, int32_t x, int32_t y, key_modifiers mod, float amount) { // an amount of 1.0 is one "click" of the wheel
+	state.ui_redraw_requested = true;
 	ui::element_base* root_elm = state.current_scene.get_root(state);
 	auto probe_result = root_elm->impl_probe_mouse(state,
 		int32_t(state.mouse_x_position / state.user_settings.ui_scale),
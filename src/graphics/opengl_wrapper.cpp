@@ -426,6 +426,7 @@ void initialize_opengl(sys::state& state) {
 
 	load_shaders(state); // create shaders
 	load_global_squares(state); // create various squares to drive the shaders with
+	load_glyph_instancing(state);
 
 	load_special_icons(state);
 
@@ -527,6 +528,7 @@ void load_shaders(sys::state& state) {
 		state.open_gl.ui_shader_inner_color_uniform = glGetUniformLocation(state.open_gl.ui_shader_program, "inner_color");
 		state.open_gl.ui_shader_subrect_uniform = glGetUniformLocation(state.open_gl.ui_shader_program, "subrect");
 		state.open_gl.ui_shader_border_size_uniform = glGetUniformLocation(state.open_gl.ui_shader_program, "border_size");
+		state.open_gl.ui_shader_glyph_instances_uniform = glGetUniformLocation(state.open_gl.ui_shader_program, "glyph_instances");
 	} else {
 		notify_user_of_fatal_opengl_error("Unable to open a necessary shader file");
 	}
@@ -596,6 +598,43 @@ void load_global_squares(sys::state& state) {
 	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 16, global_rtl_square_flipped_data, GL_STATIC_DRAW);
 }
 
+struct glyph_instance {
+	float rect[4]; // x, y, width, height in ui units
+	float subrect[4]; // x, width, y, height within the atlas texture
+	float color[4];
+};
+
+void load_glyph_instancing(sys::state& state) {
+	glGenBuffers(1, &state.open_gl.glyph_instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, state.open_gl.glyph_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glyph_instance) * 256, nullptr, GL_STREAM_DRAW);
+
+	glGenVertexArrays(1, &state.open_gl.glyph_instance_vao);
+	glBindVertexArray(state.open_gl.glyph_instance_vao);
+	glEnableVertexAttribArray(0); // position
+	glEnableVertexAttribArray(1); // texture coordinates
+	glEnableVertexAttribArray(2); // instance rectangle
+	glEnableVertexAttribArray(3); // instance atlas rectangle
+	glEnableVertexAttribArray(4); // instance color
+
+	glBindVertexBuffer(0, state.open_gl.global_square_buffer, 0, sizeof(GLfloat) * 4);
+	glBindVertexBuffer(1, state.open_gl.glyph_instance_buffer, 0, sizeof(glyph_instance));
+	glVertexBindingDivisor(1, 1);
+
+	glVertexAttribFormat(0, 2, GL_FLOAT, GL_FALSE, 0);
+	glVertexAttribFormat(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2);
+	glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, 0);
+	glVertexAttribFormat(3, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 4);
+	glVertexAttribFormat(4, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8);
+	glVertexAttribBinding(0, 0);
+	glVertexAttribBinding(1, 0);
+	glVertexAttribBinding(2, 1);
+	glVertexAttribBinding(3, 1);
+	glVertexAttribBinding(4, 1);
+
+	glBindVertexArray(state.open_gl.global_square_vao);
+}
+
 void bind_vertices_by_rotation(sys::state const& state, ui::rotation r, bool flipped, bool rtl) {
 	switch(r) {
 	case ui::rotation::upright:
@@ -1041,25 +1080,40 @@ void render_text_icon(sys::state& state, text::embedded_icon ico, float x, float
 }
 
 void text_render(
+	data const& gl,
 	FT_Library lib,
-	GLuint square_buffer,
 	float ui_scale,
-	GLuint ui_shader_subroutines_index_uniform,
-	unsigned int subroutine_1,
-	unsigned int subroutine_2,
-	GLuint ui_shader_d_rect_uniform,
-	GLuint ui_shader_subrect_uniform,
-	const std::vector<text::stored_glyph>& glyph_info,
+	unsigned int color_subroutine,
+	std::span<text::stored_glyph const> glyph_info,
 	unsigned int glyph_count,
 	float x,
 	float baseline_y,
 	float size,
-	text::font& f
+	color3f const& c,
+	text::text_effect effect,
+	text::font& f,
+	text::font_manager& fonts
 ) {
-	glBindVertexBuffer(0, square_buffer, 0, sizeof(GLfloat) * 4);
-	glUniform2ui(ui_shader_subroutines_index_uniform, subroutine_1, subroutine_2);
+	struct placed_glyph {
+		GLuint texture;
+		float rect[4];
+		float subrect[4];
+	};
+	struct glyph_run {
+		GLuint texture;
+		uint32_t first;
+		uint32_t count;
+	};
+	thread_local std::vector<placed_glyph> placed;
+	thread_local std::vector<glyph_instance> instances;
+	thread_local std::vector<glyph_run> runs;
+	placed.clear();
+	instances.clear();
+	runs.clear();
 
-	auto& font_instance = f.retrieve_stateless_instance(lib, int32_t(size * ui_scale));
+	auto& primary_instance = f.retrieve_stateless_instance(lib, int32_t(size * ui_scale));
+	text::font_at_size* fallback_instance = nullptr;
+	uint16_t fallback_font = 0;
 
 	x = std::floor(x * ui_scale);
 	baseline_y = std::floor(baseline_y * ui_scale);
@@ -1086,6 +1140,13 @@ void text_render(
 			pixel_x_off = trunc_pixel_x_off + 1.0f;
 		}
 
+		// glyphs the font could not display were shaped with a font from the fallback chain
+		if(glyph_info[i].fallback != 0 && glyph_info[i].fallback != fallback_font) {
+			fallback_font = glyph_info[i].fallback;
+			fallback_instance = &fonts.get_font_by_index(uint16_t(fallback_font - 1)).retrieve_stateless_instance(lib, int32_t(size * ui_scale));
+		}
+		auto& font_instance = glyph_info[i].fallback != 0 ? *fallback_instance : primary_instance;
+
 		font_instance.make_glyph(uint16_t(glyphid), subpixel);
 		auto& gso = font_instance.get_glyph(uint16_t(glyphid), subpixel);
 		float x_advance = float(glyph_info[i].x_advance) / text::fixed_to_fp;
@@ -1094,47 +1155,83 @@ void text_render(
 			float x_offset = pixel_x_off + float(gso.bitmap_left);
 			float y_offset = float(-gso.bitmap_top) - float(glyph_info[i].y_offset) / text::fixed_to_fp;
 
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, font_instance.textures[gso.tx_sheet]);
-
-			glUniform4f(ui_shader_d_rect_uniform, x_offset / ui_scale, (baseline_y + y_offset) / ui_scale, float(gso.width) / ui_scale, float(gso.height) / ui_scale);
-			glUniform4f(ui_shader_subrect_uniform, float(gso.x) / float(1024) /* x offset */,
-					float(gso.width) / float(1024) /* x width */, float(gso.y) / float(1024) /* y offset */,
-					float(gso.height) / float(1024) /* y height */
-			);
-
-			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+			placed.push_back(placed_glyph{
+				font_instance.textures[gso.tx_sheet],
+				{ x_offset / ui_scale, (baseline_y + y_offset) / ui_scale, float(gso.width) / ui_scale, float(gso.height) / ui_scale },
+				{ float(gso.x) / float(1024), float(gso.width) / float(1024), float(gso.y) / float(1024), float(gso.height) / float(1024) }
+			});
 		}
 
 		x += x_advance;
 		baseline_y -= (float(glyph_info[i].y_advance) / text::fixed_to_fp);
 	}
+
+	if(placed.empty())
+		return;
+
+	auto add_instance = [&](placed_glyph const& g, float dx, float dy, float r, float gr, float b, float a) {
+		if(runs.empty() || runs.back().texture != g.texture)
+			runs.push_back(glyph_run{ g.texture, uint32_t(instances.size()), 0 });
+		instances.push_back(glyph_instance{ { g.rect[0] + dx, g.rect[1] + dy, g.rect[2], g.rect[3] }, { g.subrect[0], g.subrect[1], g.subrect[2], g.subrect[3] }, { r, gr, b, a } });
+		++runs.back().count;
+	};
+
+	// the effect instances of every glyph come before any of the glyphs, so that they never cover a neighbouring glyph
+	float pixel = 1.0f / ui_scale;
+	if(effect == text::text_effect::shadow) {
+		for(auto& g : placed)
+			add_instance(g, pixel, pixel, 0.0f, 0.0f, 0.0f, 0.75f);
+	} else if(effect == text::text_effect::outline) {
+		float contrast = (0.299f * c.r + 0.587f * c.g + 0.114f * c.b) > 0.5f ? 0.0f : 1.0f;
+		for(auto& g : placed) {
+			for(int32_t dy = -1; dy <= 1; ++dy) {
+				for(int32_t dx = -1; dx <= 1; ++dx) {
+					if(dx != 0 || dy != 0)
+						add_instance(g, float(dx) * pixel, float(dy) * pixel, contrast, contrast, contrast, 1.0f);
+				}
+			}
+		}
+	}
+	for(auto& g : placed)
+		add_instance(g, 0.0f, 0.0f, c.r, c.g, c.b, 1.0f);
+
+	glBindBuffer(GL_ARRAY_BUFFER, gl.glyph_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glyph_instance) * instances.size(), instances.data(), GL_STREAM_DRAW);
+
+	glBindVertexArray(gl.glyph_instance_vao);
+	glUniform1ui(gl.ui_shader_glyph_instances_uniform, 1);
+	glUniform2ui(gl.ui_shader_subroutines_index_uniform, color_subroutine, parameters::glyph_instance);
+	glActiveTexture(GL_TEXTURE0);
+	for(auto& r : runs) {
+		glBindTexture(GL_TEXTURE_2D, r.texture);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_FAN, 0, 4, GLsizei(r.count), r.first);
+	}
+	glUniform1ui(gl.ui_shader_glyph_instances_uniform, 0);
+	glBindVertexArray(gl.global_square_vao);
+	glBindVertexBuffer(0, gl.global_square_buffer, 0, sizeof(GLfloat) * 4);
 }
 
-void render_new_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, float size, color3f const& c, text::font& f) {
-	glUniform3f(state.open_gl.ui_shader_inner_color_uniform, c.r, c.g, c.b);
-	glUniform1f(state.open_gl.ui_shader_border_size_uniform, 0.08f * 16.0f / size);
+void render_new_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, float size, color3f const& c, text::font& f, text::text_effect effect) {
 	text_render(
+		state.open_gl,
 		state.font_collection.ft_library,
-		state.open_gl.global_square_buffer,
 		state.user_settings.ui_scale,
-		state.open_gl.ui_shader_subroutines_index_uniform,
 		map_color_modification_to_index(enabled),
-		ogl::parameters::subsprite_b,
-		state.open_gl.ui_shader_d_rect_uniform,
-		state.open_gl.ui_shader_subrect_uniform,
 		txt.glyph_info,
 		static_cast<unsigned int>(txt.glyph_info.size()),
 		x,
 		y + size,
 		size,
-		f
+		c,
+		effect,
+		f,
+		state.font_collection
 	);
 }
 
-void render_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, color3f const& c, uint16_t font_id) {
+void render_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, color3f const& c, uint16_t font_id, text::text_effect effect) {
 	auto& font = state.font_collection.get_font(state, text::font_index_from_font_id(state, font_id));
-	render_new_text(state, txt, enabled, x, y, float(text::size_from_font_id(font_id)), c, font);
+	render_new_text(state, txt, enabled, x, y, float(text::size_from_font_id(font_id)), c, font, effect);
 }
 
 void lines::set_y(float* v) {
@@ -1387,6 +1484,87 @@ render_capture::~render_capture() {
 	if(framebuffer)
 		glDeleteFramebuffers(1, &framebuffer);
 }
+bool retained_render::is_ready_for(sys::state const& state, int32_t width, int32_t height) const {
+	return texture_handle && pixel_width == int32_t(std::ceil(float(width) * state.user_settings.ui_scale)) && pixel_height == int32_t(std::ceil(float(height) * state.user_settings.ui_scale));
+}
+void retained_render::begin(sys::state& state, int32_t width, int32_t height) {
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	glGetIntegerv(GL_VIEWPORT, previous_viewport);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &previous_blend[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &previous_blend[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &previous_blend[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &previous_blend[3]);
+	glGetUniformfv(state.open_gl.ui_shader_program, state.open_gl.ui_shader_screen_width_uniform, &previous_screen_width);
+	glGetUniformfv(state.open_gl.ui_shader_program, state.open_gl.ui_shader_screen_height_uniform, &previous_screen_height);
+	previous_target_height = state.open_gl.ui_target_height;
+
+	auto new_width = std::max(1, int32_t(std::ceil(float(width) * state.user_settings.ui_scale)));
+	auto new_height = std::max(1, int32_t(std::ceil(float(height) * state.user_settings.ui_scale)));
+	if(!texture_handle || new_width != pixel_width || new_height != pixel_height) {
+		release();
+		pixel_width = new_width;
+		pixel_height = new_height;
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+		glGenTextures(1, &texture_handle);
+		glBindTexture(GL_TEXTURE_2D, texture_handle);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pixel_width, pixel_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture_handle, 0);
+
+		GLenum DrawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
+		glDrawBuffers(1, DrawBuffers);
+	} else {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	// accumulate coverage in the alpha channel so that the result can be composited later
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glUniform1f(state.open_gl.ui_shader_screen_width_uniform, float(pixel_width) / state.user_settings.ui_scale);
+	glUniform1f(state.open_gl.ui_shader_screen_height_uniform, float(pixel_height) / state.user_settings.ui_scale);
+	glViewport(0, 0, pixel_width, pixel_height);
+	state.open_gl.ui_target_height = int32_t(float(pixel_height) / state.user_settings.ui_scale);
+}
+void retained_render::end(sys::state& state) {
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous_framebuffer));
+	glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+	glBlendFuncSeparate(GLenum(previous_blend[0]), GLenum(previous_blend[1]), GLenum(previous_blend[2]), GLenum(previous_blend[3]));
+	glUniform1f(state.open_gl.ui_shader_screen_width_uniform, previous_screen_width);
+	glUniform1f(state.open_gl.ui_shader_screen_height_uniform, previous_screen_height);
+	state.open_gl.ui_target_height = previous_target_height;
+}
+void retained_render::render(sys::state& state, int32_t x, int32_t y) {
+	GLint blend[4];
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blend[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blend[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blend[3]);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	render_subrect(state, float(x), float(y), float(pixel_width) / state.user_settings.ui_scale, float(pixel_height) / state.user_settings.ui_scale,
+		0.0f, 1.0f, 1.0f, -1.0f, texture_handle);
+	glBlendFuncSeparate(GLenum(blend[0]), GLenum(blend[1]), GLenum(blend[2]), GLenum(blend[3]));
+}
+void retained_render::release() {
+	if(texture_handle)
+		glDeleteTextures(1, &texture_handle);
+	if(framebuffer)
+		glDeleteFramebuffers(1, &framebuffer);
+	texture_handle = 0;
+	framebuffer = 0;
+	pixel_width = 0;
+	pixel_height = 0;
+}
+retained_render::~retained_render() {
+	release();
+}
+
 void render_subrect(sys::state const& state, float target_x, float target_y, float target_width, float target_height, float source_x, float source_y, float source_width, float source_height, GLuint texture_handle) {
 	bind_vertices_by_rotation(state, ui::rotation::upright, false, false);
 	GLuint subroutines[2] = { parameters::enabled, parameters::subsprite_c };
@@ -1538,7 +1716,8 @@ void animation::render(sys::state& state) {
 
 scissor_box::scissor_box(sys::state const& state, int32_t x, int32_t y, int32_t w, int32_t h) : x(x), y(y), w(w), h(h) {
 	glEnable(GL_SCISSOR_TEST);
-	glScissor(int32_t(x * state.user_settings.ui_scale), int32_t((state.ui_state.root->base_data.size.y - h - y) * state.user_settings.ui_scale), int32_t(w * state.user_settings.ui_scale), int32_t(h * state.user_settings.ui_scale));
+	auto target_height = state.open_gl.ui_target_height != 0 ? state.open_gl.ui_target_height : int32_t(state.ui_state.root->base_data.size.y);
+	glScissor(int32_t(x * state.user_settings.ui_scale), int32_t((target_height - h - y) * state.user_settings.ui_scale), int32_t(w * state.user_settings.ui_scale), int32_t(h * state.user_settings.ui_scale));
 }
 scissor_box::~scissor_box() {
 	glDisable(GL_SCISSOR_TEST);
@@ -165,7 +165,10 @@ inline void debug_callback(GLenum source, GLenum type, GLuint id, GLenum severit
 
 struct data {
 	tagged_vector<texture, dcon::texture_id> asset_textures;
-	ankerl::unordered_dense::map<std::string, dcon::texture_id> late_loaded_map;
+	ankerl::unordered_dense::map<std::string, dcon::texture_id, transparent_string_hash, std::equal_to<>> late_loaded_map;
+	uint64_t late_loaded_resident_bytes = 0;
+	uint32_t texture_frame = 1;
+	int32_t ui_target_height = 0; // height in ui units of the framebuffer being rendered to, if it isn't the window
 
 	void* context = nullptr;
 	bool legacy_mode = false;
@@ -185,8 +188,11 @@ struct data {
 	GLuint ui_shader_screen_width_uniform = 0;
 	GLuint ui_shader_screen_height_uniform = 0;
 	GLuint ui_shader_gamma_uniform = 0;
+	GLuint ui_shader_glyph_instances_uniform = 0;
 
 	GLuint global_square_vao = 0;
+	GLuint glyph_instance_vao = 0; // the upright square, plus one glyph_instance per drawn instance
+	GLuint glyph_instance_buffer = 0;
 	GLuint global_square_buffer = 0;
 	GLuint global_square_right_buffer = 0;
 	GLuint global_square_left_buffer = 0;
@@ -237,6 +243,7 @@ GLuint create_program(std::string_view vertex_shader, std::string_view fragment_
 GLuint create_program(std::string_view vertex_shader, std::string_view tes_control_shader, std::string_view tes_eval_shader, std::string_view fragment_shader, bool debug_geom_shader);
 void load_shaders(sys::state& state);
 void load_global_squares(sys::state& state);
+void load_glyph_instancing(sys::state& state);
 
 class bezier_path {
 public:
@@ -387,8 +394,8 @@ void render_subsprite(sys::state const& state, color_modification enabled, int f
 void render_rect_slice(sys::state const& state, float x, float y, float width, float height, GLuint texture_handle, float start_slice, float end_slice);
 void render_tinted_rect(sys::state const& state, float x, float y, float width, float height, float r, float g, float b, ui::rotation rot, bool flipped, bool rtl);
 void render_tinted_subsprite(sys::state const& state, int frame, int total_frames, float x, float y, float width, float height, float r, float g, float b, GLuint texture_handle, ui::rotation rot, bool flipped, bool rtl);
-void render_new_text(sys::state const& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, float size, color3f const& c, text::font& f);
-void render_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, color3f const& c, uint16_t font_id);
+void render_new_text(sys::state const& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, float size, color3f const& c, text::font& f, text::text_effect effect = text::text_effect::none);
+void render_text(sys::state& state, text::stored_glyphs const& txt, color_modification enabled, float x, float y, color3f const& c, uint16_t font_id, text::text_effect effect = text::text_effect::none);
 void render_text_icon(sys::state& state, text::embedded_icon ico, float x, float baseline_y, float font_size, text::font& f, ogl::color_modification = ogl::color_modification::none);
 
 void deinitialize_framebuffer_for_province_indices(sys::state& state);
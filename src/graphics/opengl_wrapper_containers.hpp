@@ -29,6 +29,31 @@ public:
 	friend class animation;
 };
 
+// the last rendering of a ui subtree, kept in its own framebuffer so that it can be drawn as a single quad
+// until the subtree changes. the contents are stored with premultiplied alpha
+class retained_render {
+private:
+	GLuint framebuffer = 0;
+	GLuint texture_handle = 0;
+	int32_t pixel_width = 0;
+	int32_t pixel_height = 0;
+
+	// render target state replaced by begin and put back by end, which allows captures to nest
+	GLint previous_framebuffer = 0;
+	GLint previous_viewport[4] = { 0, 0, 0, 0 };
+	GLint previous_blend[4] = { 0, 0, 0, 0 };
+	float previous_screen_width = 0.0f;
+	float previous_screen_height = 0.0f;
+	int32_t previous_target_height = 0;
+public:
+	bool is_ready_for(sys::state const& state, int32_t width, int32_t height) const;
+	void begin(sys::state& state, int32_t width, int32_t height); // subsequent ui rendering at 0,0 goes into the cache
+	void end(sys::state& state);
+	void render(sys::state& state, int32_t x, int32_t y);
+	void release();
+	~retained_render();
+};
+
 class animation {
 public:
 	enum class type {
@@ -56,6 +81,9 @@ public:
 	void start_animation(sys::state& state, int32_t x, int32_t y, int32_t w, int32_t h, type t, int32_t runtime);
 	void post_update_frame(sys::state& state);
 	void render(sys::state& state);
+	bool is_running() const {
+		return running;
+	}
 };
 
 class captured_element {
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "texture.hpp"
 #include "system_state.hpp"
 #include "simple_fs.hpp"
@@ -777,6 +778,8 @@ texture::~texture() {
 texture::texture(texture&& other) noexcept {
 	channels = other.channels;
 	loaded = other.loaded;
+	byte_size = other.byte_size;
+	last_used_frame = other.last_used_frame;
 	size_x = other.size_x;
 	size_y = other.size_y;
 	data = other.data;
@@ -787,6 +790,8 @@ texture::texture(texture&& other) noexcept {
 texture& texture::operator=(texture&& other) noexcept {
 	channels = other.channels;
 	loaded = other.loaded;
+	byte_size = other.byte_size;
+	last_used_frame = other.last_used_frame;
 	size_x = other.size_x;
 	size_y = other.size_y;
 	data = other.data;
@@ -887,21 +892,86 @@ GLuint load_file_and_return_handle(native_string const& native_name, simple_fs::
 }
 
 
+uint32_t texture_byte_size(GLuint handle, int32_t size_x, int32_t size_y) {
+	GLint compressed = GL_FALSE;
+	glGetTextureLevelParameteriv(handle, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if(compressed == GL_TRUE) {
+		GLint csize = 0;
+		glGetTextureLevelParameteriv(handle, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &csize);
+		return uint32_t(csize);
+	}
+	return uint32_t(4 * size_x * size_y);
+}
+
 GLuint get_late_load_texture_handle(sys::state& state, dcon::texture_id& id, std::string_view asset_name) {
-	if(id && state.open_gl.asset_textures[id].loaded) {
-		return state.open_gl.asset_textures[id].texture_handle;
-	} else {
-		if(auto it = state.open_gl.late_loaded_map.find(std::string(asset_name)); it != state.open_gl.late_loaded_map.end()) {
+	if(!id) {
+		if(auto it = state.open_gl.late_loaded_map.find(asset_name); it != state.open_gl.late_loaded_map.end()) {
 			id = it->second;
-			return state.open_gl.asset_textures[id].texture_handle;
+		} else {
+			dcon::texture_id new_id{ dcon::texture_id::value_base_t(state.open_gl.asset_textures.size()) };
+			state.open_gl.asset_textures.emplace_back();
+			id = new_id;
+			state.open_gl.late_loaded_map.insert_or_assign(std::string(asset_name), new_id);
 		}
-		dcon::texture_id new_id{ dcon::texture_id::value_base_t(state.open_gl.asset_textures.size()) };
-		state.open_gl.asset_textures.emplace_back();
-		id = new_id;
-		state.open_gl.late_loaded_map.insert_or_assign(std::string(asset_name), new_id);
+	}
+
+	auto& t = state.open_gl.asset_textures[id];
+	if(!t.loaded) { // either never loaded or evicted since the last use
 		native_string nname = native_string(NATIVE("assets")) + NATIVE_DIR_SEPARATOR + simple_fs::utf8_to_native(asset_name);
-		return load_file_and_return_handle(nname, state.common_fs, state.open_gl.asset_textures.back(), false);
+		load_file_and_return_handle(nname, state.common_fs, t, false);
+		t.byte_size = t.texture_handle ? texture_byte_size(t.texture_handle, t.size_x, t.size_y) : 0;
+		state.open_gl.late_loaded_resident_bytes += t.byte_size;
+	}
+	t.last_used_frame = state.open_gl.texture_frame;
+	return t.texture_handle;
+}
+
+void end_texture_frame(sys::state& state) {
+	auto const budget = uint64_t(state.user_settings.texture_budget_mb) * 1024 * 1024;
+	auto const current_frame = state.open_gl.texture_frame;
+	++state.open_gl.texture_frame;
+
+	if(budget == 0 || state.open_gl.late_loaded_resident_bytes <= budget)
+		return;
+
+	std::vector<dcon::texture_id> candidates;
+	for(auto& [name, id] : state.open_gl.late_loaded_map) {
+		auto& t = state.open_gl.asset_textures[id];
+		// anything drawn this frame stays, otherwise we would just reload it on the next one
+		if(t.loaded && t.texture_handle && t.last_used_frame != current_frame)
+			candidates.push_back(id);
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](dcon::texture_id a, dcon::texture_id b) {
+		auto fa = state.open_gl.asset_textures[a].last_used_frame;
+		auto fb = state.open_gl.asset_textures[b].last_used_frame;
+		if(fa != fb)
+			return fa < fb;
+		return a.index() < b.index();
+	});
+
+	for(auto id : candidates) {
+		if(state.open_gl.late_loaded_resident_bytes <= budget)
+			break;
+		auto& t = state.open_gl.asset_textures[id];
+		glDeleteTextures(1, &t.texture_handle);
+		t.texture_handle = 0;
+		t.loaded = false;
+		state.open_gl.late_loaded_resident_bytes -= t.byte_size;
+		t.byte_size = 0;
+	}
+}
+
+std::vector<texture_memory_entry> texture_memory_report(sys::state const& state) {
+	std::vector<texture_memory_entry> result;
+	result.reserve(state.open_gl.late_loaded_map.size());
+	for(auto& [name, id] : state.open_gl.late_loaded_map) {
+		auto& t = state.open_gl.asset_textures[id];
+		result.push_back(texture_memory_entry{ std::string_view(name), id, t.byte_size, t.last_used_frame, t.loaded && t.get_texture_handle() != 0 });
 	}
+	std::sort(result.begin(), result.end(), [](texture_memory_entry const& a, texture_memory_entry const& b) {
+		return a.byte_size > b.byte_size;
+	});
+	return result;
 }
 
 data_texture::data_texture(int32_t sz, int32_t ch) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string_view>
 #include "system_state_forward.hpp"
 #include "container_types.hpp"
 #include "native_types.hpp"
@@ -21,6 +22,29 @@ class texture;
 GLuint load_file_and_return_handle(native_string const& native_name, simple_fs::file_system const& fs, texture& asset_texture, bool keep_data);
 GLuint get_late_load_texture_handle(sys::state& state, dcon::texture_id& id, std::string_view asset_name);
 
+// late loaded textures are tracked for residency: each one records the frame it was last used in and its
+// approximate size in video memory. once the resident total exceeds the budget in the user settings, the least
+// recently used ones are released and will be reloaded the next time get_late_load_texture_handle asks for them
+void end_texture_frame(sys::state& state);
+
+struct texture_memory_entry {
+	std::string_view name;
+	dcon::texture_id id;
+	uint32_t byte_size = 0;
+	uint32_t last_used_frame = 0;
+	bool resident = false;
+};
+std::vector<texture_memory_entry> texture_memory_report(sys::state const& state);
+
+struct transparent_string_hash {
+	using is_transparent = void;
+	using is_avalanching = void;
+
+	auto operator()(std::string_view sv) const noexcept -> uint64_t {
+		return ankerl::unordered_dense::detail::wyhash::hash(sv.data(), sv.size());
+	}
+};
+
 enum {
 	SOIL_FLAG_TEXTURE_REPEATS = 4,
 };
@@ -38,6 +62,9 @@ public:
 
 	bool loaded = false;
 
+	uint32_t byte_size = 0;
+	uint32_t last_used_frame = 0;
+
 	texture() { }
 	texture(texture const&) = delete;
 	texture(texture&& other) noexcept;
@@ -51,6 +78,7 @@ public:
 	friend GLuint load_file_and_return_handle(native_string const& native_name, simple_fs::file_system const& fs,
 			texture& asset_texture, bool keep_data);
 	friend GLuint get_late_load_texture_handle(sys::state& state, dcon::texture_id& id, std::string_view asset_name);
+	friend void end_texture_frame(sys::state& state);
 };
 
 class data_texture {
@@ -220,6 +220,7 @@ text::alignment convert_align(template_project::aui_text_alignment a) {
 
 void template_label::set_text(sys::state& state, std::string_view new_text) {
 	if(new_text != cached_text) {
+		ui::invalidate_render_cache(*this);
 		template_project::text_region_template region;
 		grid_size_window* par = static_cast<grid_size_window*>(parent);
 
@@ -237,7 +238,7 @@ void template_label::set_text(sys::state& state, std::string_view new_text) {
 				text::layout_parameters{
 					0, 0, static_cast<int16_t>(base_data.size.x - region.h_text_margins * par->grid_size * 2), static_cast<int16_t>(base_data.size.y - region.v_text_margins * 2),
 					text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2), 0,
-					convert_align(region.h_text_alignment), text::text_color::black, true, true
+					convert_align(region.h_text_alignment), text::text_color::black, true, true, text_effect
 				},
 				state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
 			sl.add_text(state, cached_text);
@@ -250,6 +251,13 @@ void template_label::on_reset_text(sys::state& state) noexcept {
 	if(default_text)
 		set_text(state, text::produce_simple_string(state, default_text));
 }
+void template_label::on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	if(!default_text || template_id == -1)
+		return;
+	auto& region = state.ui_templates.label_t[template_id].primary;
+	grid_size_window* par = static_cast<grid_size_window*>(parent);
+	batch.queue(state, text::produce_simple_string(state, default_text), text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2));
+}
 void template_label::update_tooltip(sys::state& state, int32_t x, int32_t y, text::columnar_layout& contents) noexcept {
 	text::add_line(state, contents, default_tooltip);
 }
@@ -301,6 +309,7 @@ void template_label::render(sys::state& state, int32_t x, int32_t y) noexcept {
 
 void template_mixed_button::set_text(sys::state& state, std::string_view new_text) {
 	if(new_text != cached_text) {
+		ui::invalidate_render_cache(*this);
 		template_project::mixed_region_template region;
 		grid_size_window* par = static_cast<grid_size_window*>(parent);
 
@@ -318,7 +327,7 @@ void template_mixed_button::set_text(sys::state& state, std::string_view new_tex
 				text::layout_parameters{
 					0, 0, static_cast<int16_t>(base_data.size.x - icon_space - region.h_text_margins * par->grid_size * 2), static_cast<int16_t>(base_data.size.y - region.v_text_margins * 2),
 					text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2), 0,
-					convert_align(region.h_text_alignment), text::text_color::black, true, true
+					convert_align(region.h_text_alignment), text::text_color::black, true, true, text_effect
 				},
 				state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
 			sl.add_text(state, cached_text);
@@ -338,6 +347,13 @@ void template_mixed_button::on_reset_text(sys::state& state) noexcept {
 	if(default_text)
 		set_text(state, text::produce_simple_string(state, default_text));
 }
+void template_mixed_button::on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	if(!default_text || template_id == -1)
+		return;
+	auto& region = state.ui_templates.mixed_button_t[template_id].primary;
+	grid_size_window* par = static_cast<grid_size_window*>(parent);
+	batch.queue(state, text::produce_simple_string(state, default_text), text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2));
+}
 void template_mixed_button::update_tooltip(sys::state& state, int32_t x, int32_t y, text::columnar_layout& contents) noexcept {
 	text::add_line(state, contents, default_tooltip);
 }
@@ -557,6 +573,7 @@ void template_mixed_button_ci::render(sys::state& state, int32_t x, int32_t y) n
 
 void template_text_button::set_text(sys::state& state, std::string_view new_text) {
 	if(new_text != cached_text) {
+		ui::invalidate_render_cache(*this);
 		template_project::text_region_template region;
 		grid_size_window* par = static_cast<grid_size_window*>(parent);
 
@@ -573,7 +590,7 @@ void template_text_button::set_text(sys::state& state, std::string_view new_text
 				text::layout_parameters{
 					0, 0, static_cast<int16_t>(base_data.size.x - region.h_text_margins * par->grid_size* 2), static_cast<int16_t>(base_data.size.y - region.v_text_margins * 2),
 					text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2), 0,
-					convert_align(region.h_text_alignment), text::text_color::black, true, true
+					convert_align(region.h_text_alignment), text::text_color::black, true, true, text_effect
 				},
 				state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
 			sl.add_text(state, cached_text);
@@ -593,6 +610,13 @@ void template_text_button::on_reset_text(sys::state& state) noexcept {
 	if(default_text)
 		set_text(state, text::produce_simple_string(state, default_text));
 }
+void template_text_button::on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	if(!default_text || template_id == -1)
+		return;
+	auto& region = state.ui_templates.button_t[template_id].primary;
+	grid_size_window* par = static_cast<grid_size_window*>(parent);
+	batch.queue(state, text::produce_simple_string(state, default_text), text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2));
+}
 void template_text_button::update_tooltip(sys::state& state, int32_t x, int32_t y, text::columnar_layout& contents) noexcept {
 	text::add_line(state, contents, default_tooltip);
 }
@@ -694,6 +718,7 @@ void template_text_button::render(sys::state& state, int32_t x, int32_t y) noexc
 
 void template_toggle_button::set_text(sys::state& state, std::string_view new_text) {
 	if(new_text != cached_text) {
+		ui::invalidate_render_cache(*this);
 		template_project::toggle_region region;
 		grid_size_window* par = static_cast<grid_size_window*>(parent);
 
@@ -713,7 +738,7 @@ void template_toggle_button::set_text(sys::state& state, std::string_view new_te
 				text::layout_parameters{
 					0, 0, static_cast<int16_t>(base_data.size.x - (l + r)), static_cast<int16_t>(base_data.size.y),
 					text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2), 0,
-					convert_align(region.h_text_alignment), text::text_color::black, true, true
+					convert_align(region.h_text_alignment), text::text_color::black, true, true, text_effect
 				},
 				state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
 			sl.add_text(state, cached_text);
@@ -741,6 +766,13 @@ void template_toggle_button::set_active(sys::state& state, bool active) {
 		set_text(state, temp);
 	}
 }
+void template_toggle_button::on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	if(!default_text || template_id == -1)
+		return;
+	auto& region = is_active ? state.ui_templates.toggle_button_t[template_id].on_region : state.ui_templates.toggle_button_t[template_id].off_region;
+	grid_size_window* par = static_cast<grid_size_window*>(parent);
+	batch.queue(state, text::produce_simple_string(state, default_text), text::make_font_id(state, region.font_choice == 1, region.font_scale * par->grid_size * 2));
+}
 void template_toggle_button::update_tooltip(sys::state& state, int32_t x, int32_t y, text::columnar_layout& contents) noexcept {
 	text::add_line(state, contents, default_tooltip);
 }
@@ -953,6 +985,17 @@ void page_buttons::render(sys::state& state, int32_t x, int32_t y) noexcept {
 			}
 	}
 }
+ui::message_result page_buttons::on_mouse_move(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
+	// the arrow under the mouse is highlighted, and moving between the arrows doesn't change under_mouse.
+	// measured the same way render does, since the relative location is only updated once a frame
+	int32_t rel_mouse_x = int32_t(state.mouse_x_position / state.user_settings.ui_scale) - ui::get_absolute_location(state, *this).x;
+	int8_t arrow = rel_mouse_x <= base_data.size.y ? int8_t(0) : (base_data.size.x - base_data.size.y <= rel_mouse_x ? int8_t(1) : int8_t(-1));
+	if(arrow != hovered_arrow) {
+		hovered_arrow = arrow;
+		ui::invalidate_render_cache(*this);
+	}
+	return ui::message_result::unseen;
+}
 ui::message_result page_buttons::on_lbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
 	if(last_size <= 1)
 		return ui::message_result::unseen;
@@ -1177,6 +1220,17 @@ ui::message_result drop_down_list_page_buttons::test_mouse(sys::state& state, in
 	}
 }
 
+ui::message_result drop_down_list_page_buttons::on_mouse_move(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
+	// the arrow under the mouse is highlighted, and moving between the arrows doesn't change under_mouse.
+	// measured the same way render does, since the relative location is only updated once a frame
+	int32_t rel_mouse_x = int32_t(state.mouse_x_position / state.user_settings.ui_scale) - ui::get_absolute_location(state, *this).x;
+	int8_t arrow = rel_mouse_x <= base_data.size.y ? int8_t(0) : (base_data.size.x - base_data.size.y <= rel_mouse_x ? int8_t(1) : int8_t(-1));
+	if(arrow != hovered_arrow) {
+		hovered_arrow = arrow;
+		ui::invalidate_render_cache(*this);
+	}
+	return ui::message_result::unseen;
+}
 ui::message_result drop_down_list_page_buttons::on_lbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
 	if(!owner_control)
 		return ui::message_result::unseen;
@@ -1233,6 +1287,7 @@ void template_drop_down_control::open_list(sys::state& state) {
 	auto current_root = state.current_scene.get_root(state);
 	if(!state.ui_state.popup_menu) {
 		auto new_menu = std::make_unique<alice_ui::pop_up_menu_container>();
+		new_menu->retain_render = true;
 		state.ui_state.popup_menu = new_menu.get();
 		current_root->add_child_to_back(std::move(new_menu));
 	}
@@ -1296,7 +1351,7 @@ void template_drop_down_control::open_list(sys::state& state) {
 	state.ui_state.popup_menu->grid_size = par->grid_size;
 	state.ui_state.popup_menu->bg_template = state.ui_templates.drop_down_t[template_id].dropdown_window_bg;
 
-	state.ui_state.popup_menu->flags = uint8_t(state.ui_state.popup_menu->flags & ~is_invisible_mask);
+	state.ui_state.popup_menu->set_visible(state, true);
 	if(state.ui_state.popup_menu->parent != current_root) {
 		auto take_child = state.ui_state.popup_menu->parent->remove_child(state.ui_state.popup_menu);
 		current_root->add_child_to_front(std::move(take_child));
@@ -1317,6 +1372,8 @@ void template_drop_down_control::change_page(sys::state& state, int32_t to_page)
 		return;
 
 	state.ui_state.popup_menu->children.clear();
+	ui::invalidate_update_dependencies(*state.ui_state.popup_menu);
+	ui::invalidate_render_cache(*state.ui_state.popup_menu);
 	page_text_out_of_date = true;
 
 	grid_size_window* par = static_cast<grid_size_window*>(parent);
@@ -1354,7 +1411,7 @@ void template_drop_down_control::change_page(sys::state& state, int32_t to_page)
 		child->base_data.position.x = int16_t(x_offset);
 		child->base_data.position.y = int16_t(y_offset);
 		child->parent = state.ui_state.popup_menu;
-		child->impl_on_update(state);
+		ui::update_all_channels(state, *child);
 		++index;
 	}
 
@@ -1382,7 +1439,7 @@ void template_drop_down_control::change_page(sys::state& state, int32_t to_page)
 		list_buttons_pool[index]->base_data.size.x = int16_t(elm_h_size);
 		list_buttons_pool[index]->base_data.size.y = int16_t(element_y_size);
 		list_buttons_pool[index]->parent = state.ui_state.popup_menu;
-		list_buttons_pool[index]->impl_on_update(state);
+		ui::update_all_channels(state, *list_buttons_pool[index]);
 		alt = !alt;
 		++index;
 	}
@@ -1467,8 +1524,9 @@ void template_drop_down_control::render(sys::state& state, int32_t x, int32_t y)
 void layout_window_element::initialize_template(sys::state& state, int32_t id, int32_t gs, bool ac) {
 	window_template = id;
 	grid_size = gs;
+	retain_render = true;
 	if(ac) {
-		auto_close = std::make_unique<auto_close_button>();
+		auto_close = element_storage.make<auto_close_button>();
 		auto_close->base_data.size.x = int16_t(grid_size * 3);
 		auto_close->base_data.size.y = int16_t(grid_size * 3);
 		auto_close->base_data.flags = uint8_t(ui::orientation::upper_right);
@@ -1512,6 +1570,7 @@ layout_level* innermost_scroll_level(layout_level& current, int32_t x, int32_t y
 }
 
 ui::message_result layout_window_element::on_scroll(sys::state& state, int32_t x, int32_t y, float amount, sys::key_modifiers mods) noexcept {
+	ensure_layout(state);
 	auto sub_layout = innermost_scroll_level(layout, x, y);
 	if(sub_layout) {
 		sub_layout->change_page(state, *this, sub_layout->current_page + ((amount < 0) ? 1 : -1));
@@ -1678,7 +1737,7 @@ struct layout_iterator {
 			if(i.fill_y)
 				i.ptr->base_data.size.y = int16_t(height);
 			destination->children.push_back(i.ptr);
-			i.ptr->impl_on_update(state);
+			ui::update_all_channels(state, *i.ptr);
 		} else if(std::holds_alternative<layout_window>(m)) {
 			auto& i = std::get<layout_window>(m);
 			if(i.absolute_position) {
@@ -1693,7 +1752,7 @@ struct layout_iterator {
 			if(i.fill_y)
 				i.ptr->base_data.size.y = int16_t(height);
 			destination->children.push_back(i.ptr.get());
-			i.ptr->impl_on_update(state);
+			ui::update_all_channels(state, *i.ptr);
 		} else if(std::holds_alternative<layout_glue>(m)) {
 
 		} else if(std::holds_alternative<generator_instance>(m)) {
@@ -1764,8 +1823,51 @@ struct layout_iterator {
 	}
 };
 
+// placing an element updates it, so the children are only visited here while no relayout is pending. they count
+// toward the subtree either way, since the window has to be visited for them to be relaid out
 void layout_window_element::impl_on_update(sys::state& state) noexcept {
-	on_update(state);
+	if((update_dependencies & state.ui_state.active_update_channels) != 0) {
+		on_update(state);
+		ui::invalidate_render_cache(*this);
+	}
+	// placed children are updated when they are laid out, not from here, so they add nothing to the subtree
+	subtree_update_dependencies = update_dependencies;
+}
+
+void layout_window_element::ensure_layout(sys::state& state) {
+	bool resized = laid_out_size.x != base_data.size.x || laid_out_size.y != base_data.size.y;
+	if(!layout_pending && !(has_layout && resized))
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	// pages only have to be rebuilt when their contents or the space they are broken into changed
+	bool remake_lists = layout_lists_pending || resized || !has_layout;
+	// cleared first, so that a request made by a child while it is being placed is kept for the next pass
+	layout_pending = false;
+	layout_lists_pending = false;
+	has_layout = true;
+	laid_out_size = base_data.size;
+	perform_layout(state, remake_lists);
+
+	++state.ui_state.layout_passes;
+	state.ui_state.layout_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+void layout_window_element::impl_render(sys::state& state, int32_t x, int32_t y) noexcept {
+	ensure_layout(state);
+	grid_size_window::impl_render(state, x, y);
+}
+ui::mouse_probe layout_window_element::impl_probe_mouse(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_type type) noexcept {
+	ensure_layout(state);
+	return grid_size_window::impl_probe_mouse(state, x, y, type);
+}
+void layout_window_element::impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_set& probes) noexcept {
+	ensure_layout(state);
+	grid_size_window::impl_probe_mouse_combined(state, x, y, probes);
+}
+ui::drag_and_drop_query_result layout_window_element::impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept {
+	ensure_layout(state);
+	return grid_size_window::impl_drag_and_drop_query(state, x, y, data_type);
 }
 
 void layout_window_element::clear_pages_internal(layout_level& lvl) {
@@ -1820,7 +1922,7 @@ void layout_window_element::render_layout_internal(layout_level& lvl, sys::state
 struct layout_box {
 	uint16_t x_dim = 0;
 	uint16_t y_dim = 0;
-	uint16_t item_count = 0;
+	uint32_t item_count = 0;
 	uint16_t space_conumer_count = 0;
 	uint16_t non_glue_count = 0;
 	bool end_page = false;
@@ -1992,6 +2094,22 @@ layout_box measure_vertical_box(sys::state& state, layout_iterator& source, int3
 	return result;
 }
 
+bool page_uniform_generator(sys::state& state, layout_level& lvl, bool horizontal, int32_t available_space) {
+	if(lvl.contents.size() != 1 || !std::holds_alternative<generator_instance>(lvl.contents[0]))
+		return false;
+	auto generator = std::get<generator_instance>(lvl.contents[0]).generator;
+	auto extent = generator->uniform_item_extent(state, horizontal);
+	if(extent <= 0)
+		return false;
+
+	auto count = uint32_t(generator->item_count());
+	auto per_page = uint32_t(std::max(1, available_space / extent));
+	for(uint32_t end = per_page; end < count; end += per_page)
+		lvl.page_starts.push_back(page_info{ end });
+	lvl.page_starts.push_back(page_info{ count });
+	return true;
+}
+
 void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state& state, int32_t x, int32_t y, int32_t w, int32_t h, bool remake_pages) {
 	auto base_x_size = lvl.size_x != -1 ? int32_t(lvl.size_x) : w;
 	auto base_y_size = lvl.size_y != -1 ? int32_t(lvl.size_y) : h;
@@ -2020,50 +2138,54 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 		switch(lvl.type) {
 		case layout_type::single_horizontal:
 		{
+			if(page_uniform_generator(state, lvl, true, effective_x_size))
+				break;
 			layout_iterator it(lvl.contents);
 			// measure loop
-			int32_t running_count = 0;
+			uint32_t running_count = 0;
 			while(it.has_more()) {
 				auto box = measure_horizontal_box(state, it, effective_x_size, effective_y_size);
-				lvl.page_starts.push_back(page_info{ uint16_t(running_count + box.item_count) });
+				lvl.page_starts.push_back(page_info{ uint32_t(running_count + box.item_count) });
 				running_count += box.item_count;
 				assert(box.item_count > 0);
 			}
 			if(lvl.page_starts.empty()) {
-				lvl.page_starts.push_back(page_info{ uint16_t(0) });
+				lvl.page_starts.push_back(page_info{ uint32_t(0) });
 			}
 		} break;
 		case layout_type::single_vertical:
 		{
+			if(page_uniform_generator(state, lvl, false, effective_y_size))
+				break;
 			layout_iterator it(lvl.contents);
 			// measure loop
-			int32_t running_count = 0;
+			uint32_t running_count = 0;
 			while(it.has_more()) {
 				auto box = measure_vertical_box(state, it, effective_x_size, effective_y_size);
-				lvl.page_starts.push_back(page_info{ uint16_t(running_count + box.item_count) });
+				lvl.page_starts.push_back(page_info{ uint32_t(running_count + box.item_count) });
 				running_count += box.item_count;
 				assert(box.item_count > 0);
 			}
 			if(lvl.page_starts.empty()) {
-				lvl.page_starts.push_back(page_info{ uint16_t(0) });
+				lvl.page_starts.push_back(page_info{ uint32_t(0) });
 			}
 		} break;
 		case layout_type::overlapped_horizontal:
 		{
 			layout_iterator it(lvl.contents);
 			auto box = measure_horizontal_box(state, it, std::numeric_limits<int32_t>::max(), effective_y_size);
-			lvl.page_starts.push_back(page_info{ uint16_t(box.item_count) });
+			lvl.page_starts.push_back(page_info{ uint32_t(box.item_count) });
 		} break;
 		case layout_type::overlapped_vertical:
 		{
 			layout_iterator it(lvl.contents);
 			auto box = measure_vertical_box(state, it, effective_x_size, std::numeric_limits<int32_t>::max());
-			lvl.page_starts.push_back(page_info{ uint16_t(box.item_count) });
+			lvl.page_starts.push_back(page_info{ uint32_t(box.item_count) });
 		} break;
 		case layout_type::mulitline_horizontal:
 		{
 			layout_iterator it(lvl.contents);
-			int32_t running_count = 0;
+			uint32_t running_count = 0;
 
 			while(it.has_more()) {
 				int32_t y_remaining = effective_y_size;
@@ -2085,16 +2207,16 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 						break;
 					first = false;
 				}
-				lvl.page_starts.push_back(page_info{ uint16_t(running_count)  });
+				lvl.page_starts.push_back(page_info{ uint32_t(running_count)  });
 			}
 			if(lvl.page_starts.empty()) {
-				lvl.page_starts.push_back(page_info{ uint16_t(0) });
+				lvl.page_starts.push_back(page_info{ uint32_t(0) });
 			}
 		} break;
 		case layout_type::multiline_vertical:
 		{
 			layout_iterator it(lvl.contents);
-			int32_t running_count = 0;
+			uint32_t running_count = 0;
 
 			while(it.has_more()) {
 				int32_t x_remaining = effective_x_size;
@@ -2116,10 +2238,10 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 						break;
 					first = false;
 				}
-				lvl.page_starts.push_back(page_info{ uint16_t(running_count) });
+				lvl.page_starts.push_back(page_info{ uint32_t(running_count) });
 			}
 			if(lvl.page_starts.empty()) {
-				lvl.page_starts.push_back(page_info{ uint16_t(0) });
+				lvl.page_starts.push_back(page_info{ uint32_t(0) });
 			}
 		} break;
 		}
@@ -2183,7 +2305,7 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 
 		space_used = x + extra_lead + left_margin;
 		bool alternate = true;
-		for(uint16_t i = 0; i < box.item_count; ++i) {
+		for(uint32_t i = 0; i < box.item_count; ++i) {
 			auto mr =  it.measure_current(state, true, effective_y_size, i == 0);
 			int32_t yoff = 0;
 			int32_t xoff = space_used;
@@ -2233,7 +2355,7 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 
 		space_used = y + extra_lead + top_margin;
 		bool alternate = true;
-		for(uint16_t i = 0; i < box.item_count; ++i) {
+		for(uint32_t i = 0; i < box.item_count; ++i) {
 			auto mr = it.measure_current(state, false, effective_x_size, i == 0);
 
 			int32_t xoff = 0;
@@ -2418,7 +2540,7 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 			}
 			auto space_used = x + extra_lead + left_margin;
 
-			for(uint16_t i = 0; i < box.item_count; ++i) {
+			for(uint32_t i = 0; i < box.item_count; ++i) {
 				auto mr = place_it.measure_current(state, false, effective_x_size, i == 0);
 
 				int32_t yoff = 0;
@@ -2483,7 +2605,7 @@ void layout_window_element::remake_layout_internal(layout_level& lvl, sys::state
 			}
 			auto space_used = y + extra_lead + top_margin;
 
-			for(uint16_t i = 0; i < box.item_count; ++i) {
+			for(uint32_t i = 0; i < box.item_count; ++i) {
 				auto mr = place_it.measure_current(state, false, effective_x_size, i == 0);
 
 				int32_t xoff = 0;
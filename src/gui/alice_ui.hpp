@@ -62,9 +62,66 @@ public:
 	virtual measure_result place_item(sys::state& state, ui::non_owning_container_base* destination, size_t index, int32_t x, int32_t y, bool first_in_section, bool& alternate) = 0;
 	virtual size_t item_count() = 0;
 	virtual void reset_pools() = 0;
+	// a generator whose items all take the same space along the layout direction can report it here. a level
+	// holding only that generator is then paged from the item size alone, and only the items of the current page
+	// are ever placed, no matter how many there are
+	virtual int32_t uniform_item_extent(sys::state& state, bool horizontal) {
+		return -1;
+	}
 	virtual ~layout_generator() { }
 };
 
+// a generator for lists whose rows all have the same size, such as ledgers, logs and the rows of tables. only the rows
+// of the page on display are placed, from a pool that grows to one page's worth, and the level holding it is paged from
+// the row size alone. a window supplies the row element, how to make one and how to show an item in it
+template<typename item_type, typename row_type>
+class uniform_list_generator : public layout_generator {
+public:
+	std::vector<item_type> values;
+	std::vector<std::unique_ptr<row_type>> row_pool;
+	size_t rows_used = 0;
+
+	virtual std::unique_ptr<row_type> make_row(sys::state& state) = 0;
+	virtual void show_item(sys::state& state, row_type& row, item_type const& value, bool alternate) = 0;
+
+	// every row is the size of the first one made
+	ui::xy_pair row_size(sys::state& state) {
+		if(row_pool.empty())
+			row_pool.push_back(make_row(state));
+		return row_pool[0]->base_data.size;
+	}
+
+	measure_result place_item(sys::state& state, ui::non_owning_container_base* destination, size_t index, int32_t x, int32_t y, bool first_in_section, bool& alternate) override {
+		if(index >= values.size())
+			return measure_result{ 0, 0, measure_result::special::none };
+		auto size = row_size(state);
+		if(destination) {
+			if(rows_used >= row_pool.size())
+				row_pool.push_back(make_row(state));
+			auto& row = *row_pool[rows_used];
+			++rows_used;
+			row.base_data.position.x = int16_t(x);
+			row.base_data.position.y = int16_t(y);
+			row.parent = destination;
+			destination->children.push_back(&row);
+			show_item(state, row, values[index], alternate);
+			ui::update_all_channels(state, row);
+		}
+		alternate = !alternate;
+		return measure_result{ size.x, size.y, measure_result::special::none };
+	}
+	size_t item_count() override {
+		return values.size();
+	}
+	void reset_pools() override {
+		rows_used = 0;
+	}
+	int32_t uniform_item_extent(sys::state& state, bool horizontal) override {
+		auto size = row_size(state);
+		return horizontal ? size.x : size.y;
+	}
+};
+
 struct generator_instance {
 	layout_generator* generator;
 };
@@ -124,7 +181,7 @@ enum class animation_type : uint8_t {
 };
 
 struct page_info {
-	uint16_t last_index = 0;
+	uint32_t last_index = 0;
 };
 struct layout_level {
 	std::vector<layout_item> contents;
@@ -157,11 +214,16 @@ struct layout_window;
 class page_buttons : public ui::element_base {
 public:
 	text::layout text_layout;
+	int8_t hovered_arrow = -1; // 0 for the left button, 1 for the right one
 
 	layout_level* for_layout = nullptr;
 	int16_t last_page = -1;
 	int16_t last_size = -1;
 
+	page_buttons() {
+		update_dependencies = 0;
+	}
+
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 	ui::tooltip_behavior has_tooltip(sys::state& state) noexcept override {
 		return ui::tooltip_behavior::no_tooltip;
@@ -174,6 +236,7 @@ public:
 		}
 	}
 
+	ui::message_result on_mouse_move(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override;
 	ui::message_result on_lbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override;
 	ui::message_result on_rbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override {
 		return ui::message_result::consumed;
@@ -327,6 +390,10 @@ public:
 
 class auto_close_button : public template_icon_button {
 public:
+	auto_close_button() {
+		update_dependencies = 0;
+	}
+
 	ui::message_result on_key_down(sys::state& state, sys::virtual_key key, sys::key_modifiers mods) noexcept override;
 	bool button_action(sys::state& state) noexcept override;
 };
@@ -335,13 +402,21 @@ class template_label : public ui::element_base {
 protected:
 	std::string cached_text;
 	text::layout internal_layout;
+	text::text_effect text_effect = text::text_effect::none;
 public:
 	int32_t template_id = -1;
 	dcon::text_key default_text;
 	dcon::text_key default_tooltip;
 
 	void set_text(sys::state& state, std::string_view new_text);
+	void set_text_effect(sys::state& state, text::text_effect e) {
+		text_effect = e;
+		for(auto& t : internal_layout.contents)
+			t.effect = e;
+		ui::invalidate_render_cache(*this);
+	}
 	void on_reset_text(sys::state& state) noexcept override;
+	void on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	void on_create(sys::state& state) noexcept override;
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 
@@ -364,6 +439,7 @@ class template_text_button : public ui::element_base {
 protected:
 	std::string cached_text;
 	text::layout internal_layout;
+	text::text_effect text_effect = text::text_effect::none;
 public:
 	int32_t template_id = -1;
 	std::chrono::steady_clock::time_point last_activated;
@@ -373,7 +449,14 @@ public:
 	sys::virtual_key shortcut = sys::virtual_key::NONE;
 
 	void set_text(sys::state& state, std::string_view new_text);
+	void set_text_effect(sys::state& state, text::text_effect e) {
+		text_effect = e;
+		for(auto& t : internal_layout.contents)
+			t.effect = e;
+		ui::invalidate_render_cache(*this);
+	}
 	void on_reset_text(sys::state& state) noexcept override;
+	void on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	void on_create(sys::state& state) noexcept override;
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 
@@ -469,6 +552,7 @@ class template_mixed_button : public ui::element_base {
 protected:
 	std::string cached_text;
 	text::layout internal_layout;
+	text::text_effect text_effect = text::text_effect::none;
 public:
 	int32_t template_id = -1;
 	std::chrono::steady_clock::time_point last_activated;
@@ -479,7 +563,14 @@ public:
 	sys::virtual_key shortcut = sys::virtual_key::NONE;
 
 	void set_text(sys::state& state, std::string_view new_text);
+	void set_text_effect(sys::state& state, text::text_effect e) {
+		text_effect = e;
+		for(auto& t : internal_layout.contents)
+			t.effect = e;
+		ui::invalidate_render_cache(*this);
+	}
 	void on_reset_text(sys::state& state) noexcept override;
+	void on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	void on_create(sys::state& state) noexcept override;
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 
@@ -582,6 +673,7 @@ class template_toggle_button : public ui::element_base {
 protected:
 	std::string cached_text;
 	text::layout internal_layout;
+	text::text_effect text_effect = text::text_effect::none;
 private:
 	bool is_active = false;
 public:
@@ -593,8 +685,15 @@ public:
 	sys::virtual_key shortcut = sys::virtual_key::NONE;
 	
 	void set_text(sys::state& state, std::string_view new_text);
+	void set_text_effect(sys::state& state, text::text_effect e) {
+		text_effect = e;
+		for(auto& t : internal_layout.contents)
+			t.effect = e;
+		ui::invalidate_render_cache(*this);
+	}
 	void set_active(sys::state& state, bool active);
 	void on_reset_text(sys::state& state) noexcept override;
+	void on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	void on_create(sys::state& state) noexcept override;
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 
@@ -728,6 +827,10 @@ public:
 	template_drop_down_control* owner_control = nullptr;
 	int32_t list_id = 0;
 
+	drop_down_list_button() {
+		update_dependencies = sys::channel_bit(sys::update_channel::shown); // only reads its owner, which updates it when opening a page
+	}
+
 	void on_update(sys::state& state) noexcept override;
 	bool button_action(sys::state& state) noexcept override;
 };
@@ -735,13 +838,19 @@ public:
 class drop_down_list_page_buttons : public ui::element_base {
 public:
 	text::layout text_layout;
+	int8_t hovered_arrow = -1; // 0 for the left button, 1 for the right one
 	template_drop_down_control* owner_control = nullptr;
 
+	drop_down_list_page_buttons() {
+		update_dependencies = 0;
+	}
+
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 	ui::tooltip_behavior has_tooltip(sys::state& state) noexcept override {
 		return ui::tooltip_behavior::no_tooltip;
 	}
 	ui::message_result test_mouse(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_type type) noexcept override;
+	ui::message_result on_mouse_move(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override;
 	ui::message_result on_lbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override;
 	ui::message_result on_rbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept override {
 		return ui::message_result::consumed;
@@ -781,12 +890,36 @@ public:
 		}
 		return element_base::impl_probe_mouse(state, x, y, type);
 	}
+	void impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_set& probes) noexcept final {
+		if(label_window->is_visible()) {
+			auto relative_location = child_relative_location(state, *this, *label_window);
+			label_window->impl_probe_mouse_combined(state, x - relative_location.x, y - relative_location.y, probes);
+			if(probes.complete())
+				return;
+		}
+		if(!probes.click.under_mouse) {
+			auto r = element_base::impl_probe_mouse(state, x, y, ui::mouse_probe_type::click);
+			if(r.under_mouse)
+				probes.click = r;
+		}
+		if(!probes.tooltip.under_mouse) {
+			auto r = element_base::impl_probe_mouse(state, x, y, ui::mouse_probe_type::tooltip);
+			if(r.under_mouse)
+				probes.tooltip = r;
+		}
+	}
 	ui::message_result impl_on_key_down(sys::state& state, sys::virtual_key key, sys::key_modifiers mods) noexcept final {
 		return label_window->impl_on_key_down(state, key, mods);
 	}
 	void impl_on_update(sys::state& state) noexcept final {
-		on_update(state);
-		label_window->impl_on_update(state);
+		auto channels = state.ui_state.active_update_channels;
+		if((update_dependencies & channels) != 0) {
+			on_update(state);
+			ui::invalidate_render_cache(*this);
+		}
+		if((label_window->subtree_update_dependencies & channels) != 0)
+			label_window->impl_on_update(state);
+		subtree_update_dependencies = update_dependencies | label_window->subtree_update_dependencies;
 	}
 	void impl_render(sys::state& state, int32_t x, int32_t y) noexcept final {
 		render(state, x, y);
@@ -798,6 +931,9 @@ public:
 	void impl_on_reset_text(sys::state& state) noexcept final {
 		label_window->impl_on_reset_text(state);
 	}
+	void impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept final {
+		label_window->impl_on_queue_text_shaping(state, batch);
+	}
 
 	void on_create(sys::state& state) noexcept override;
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
@@ -868,6 +1004,9 @@ private:
 	void render_layout_internal(layout_level& lvl, sys::state& state, int32_t x, int32_t y);
 	void clear_pages_internal(layout_level& lvl);
 public:
+	// generated windows make their elements here. it is destroyed after their members and after the members below,
+	// so it outlives everything made from it
+	ui::element_arena element_storage;
 	layout_level layout;
 	std::unique_ptr<auto_close_button> auto_close;
 
@@ -880,7 +1019,20 @@ public:
 	
 	std::vector<positioned_texture> textures_to_render{};
 
+	bool layout_pending = false;
+	bool layout_lists_pending = false;
+	bool has_layout = false;
+	ui::xy_pair laid_out_size{ 0, 0 };
+
+	// only records that the layout is stale; the rebuild happens the next time the window is drawn or hit tested,
+	// so any number of requests in a frame cost a single pass
 	void remake_layout(sys::state& state, bool remake_lists) {
+		layout_pending = true;
+		layout_lists_pending = layout_lists_pending || remake_lists;
+		ui::invalidate_render_cache(*this);
+	}
+	void ensure_layout(sys::state& state);
+	void perform_layout(sys::state& state, bool remake_lists) {
 		children.clear();
 		textures_to_render.clear();
 		if(remake_lists)
@@ -889,9 +1041,17 @@ public:
 		std::reverse(children.begin(), children.end());
 		if(auto_close)
 			children.push_back(auto_close.get());
+		use_hit_grid = true;
+		hit_grid.valid = false;
+		ui::invalidate_render_cache(*this);
+		ui::invalidate_update_dependencies(*this);
 	}
 	ui::message_result on_scroll(sys::state& state, int32_t x, int32_t y, float amount, sys::key_modifiers mods) noexcept override;
 	void impl_on_update(sys::state& state) noexcept override;
+	void impl_render(sys::state& state, int32_t x, int32_t y) noexcept override;
+	ui::mouse_probe impl_probe_mouse(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_type type) noexcept override;
+	void impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_set& probes) noexcept override;
+	ui::drag_and_drop_query_result impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept override;
 	void initialize_template(sys::state& state, int32_t id, int32_t grid_size, bool auto_close);
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 	ui::message_result test_mouse(sys::state& state, int32_t x, int32_t y, ui::mouse_probe_type type) noexcept override {
@@ -913,7 +1073,7 @@ ui::element_base* display_at_front(sys::state& state, display_closure_command fn
 		auto new_item = GEN_FN(state);
 		auto ptr = new_item.get();
 		current_root->add_child_to_back(std::move(new_item));
-		ptr->impl_on_update(state);
+		ui::update_all_channels(state, *ptr);
 		return ptr;
 	}();
 
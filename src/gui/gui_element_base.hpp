@@ -4,6 +4,7 @@
 #include "gui_graphics.hpp"
 #include "text.hpp"
 #include "container_types_ui.hpp"
+#include <new>
 
 
 namespace ui {
@@ -36,24 +37,41 @@ struct drag_and_drop_query_result {
 	}
 };
 
+// marks the element and every container above it as needing to re-render any retained rendering they keep
+void invalidate_render_cache(element_base& e) noexcept;
+// runs impl_on_update on the element as though every update channel had changed
+void update_all_channels(sys::state& state, element_base& e) noexcept;
+// must be called when elements are added below e, so that updates stop skipping e until it has seen them
+void invalidate_update_dependencies(element_base& e) noexcept;
+
 class element_base {
 public:
 	static constexpr uint8_t is_invisible_mask = 0x01;
 	static constexpr uint8_t wants_update_when_hidden_mask = 0x02;
+	static constexpr uint8_t render_cache_dirty_mask = 0x04;
+	static constexpr uint8_t is_arena_allocated_mask = 0x08;
 
 	element_data base_data;
 	element_base* parent = nullptr;
+	sys::update_channels update_dependencies = sys::all_update_channels; // the channels on_update reads; 0 for an element that needs no updates
+	sys::update_channels subtree_update_dependencies = sys::all_update_channels; // the channels anything at or below this element reads
 	uint8_t flags = 0;
 
 	bool is_visible() const {
 		return (flags & is_invisible_mask) == 0;
 	}
+	void set_update_dependencies(sys::update_channels channels) {
+		update_dependencies = channels;
+		invalidate_update_dependencies(*this);
+	}
 	void set_visible(sys::state& state, bool vis) {
 		auto old_visibility = is_visible();
 		flags = uint8_t((flags & ~is_invisible_mask) | (vis ? 0 : is_invisible_mask));
+		if(vis != old_visibility)
+			invalidate_render_cache(*this);
 		if(vis && !old_visibility) {
 			if((wants_update_when_hidden_mask & flags) == 0)
-				impl_on_update(state);
+				update_all_channels(state, *this);
 			on_visible(state);
 		} else if(!vis && old_visibility) {
 			on_hide(state);
@@ -66,6 +84,9 @@ public:
 	//       - are responsible for propagating messages and responses
 	//       - should be called in general when something happens
 	virtual mouse_probe impl_probe_mouse(sys::state& state, int32_t x, int32_t y, mouse_probe_type type) noexcept; // tests which element is under the cursor
+	// fills in whichever of the click and tooltip probes are still empty; containers resolve both in one pass over their children
+	// the default forwards to impl_probe_mouse, so an element overriding only that keeps its behavior
+	virtual void impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept;
 	virtual drag_and_drop_query_result impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept {
 		return drag_and_drop_query_result{};
 	}
@@ -83,6 +104,9 @@ public:
 
 	virtual void impl_render(sys::state& state, int32_t x, int32_t y) noexcept;
 	virtual void impl_on_reset_text(sys::state& state) noexcept;
+	virtual void impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+		on_queue_text_shaping(state, batch);
+	}
 	virtual void impl_on_drag_finish(sys::state& state) noexcept {
 		on_drag_finish(state);
 	}
@@ -135,6 +159,7 @@ protected:
 	virtual void on_visible(sys::state& state) noexcept { }
 	virtual void on_hide(sys::state& state) noexcept { }
 	virtual void on_reset_text(sys::state& state) noexcept { }
+	virtual void on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept { } // offers the text on_reset_text is about to lay out
 public:
 	virtual void on_text(sys::state& state, char32_t ch) noexcept { }
 	virtual void on_drag(sys::state& state, int32_t oldx, int32_t oldy, int32_t x, int32_t y, sys::key_modifiers mods) noexcept; // as drag events are generated
@@ -160,6 +185,66 @@ public:
 	}
 
 	virtual ~element_base() { }
+
+	// destroys the element through its virtual destructor. the memory of an element made by an element_arena stays with
+	// the arena; any other element is freed with the size and alignment of its own type
+	void operator delete(element_base* p, std::destroying_delete_t, std::size_t size) noexcept {
+		bool from_arena = (p->flags & is_arena_allocated_mask) != 0;
+		p->~element_base();
+		if(!from_arena)
+			::operator delete(static_cast<void*>(p), size);
+	}
+	void operator delete(element_base* p, std::destroying_delete_t, std::size_t size, std::align_val_t alignment) noexcept {
+		bool from_arena = (p->flags & is_arena_allocated_mask) != 0;
+		p->~element_base();
+		if(!from_arena)
+			::operator delete(static_cast<void*>(p), size, alignment);
+	}
+};
+
+// bump allocator holding the elements of one window next to each other in creation order. they are still owned and
+// destroyed through their unique_ptrs, but their memory is only given back, all at once, when the arena is destroyed,
+// so the arena has to outlive everything made from it. blocks start small and double, unless reserve is told how much
+// the window will need up front
+class element_arena {
+	struct block {
+		std::unique_ptr<std::byte[]> memory;
+		size_t size = 0;
+		size_t used = 0;
+	};
+	std::vector<block> blocks;
+	size_t next_block_size = first_block_size;
+	size_t allocations = 0;
+	size_t used = 0;
+	size_t reserved = 0;
+public:
+	static constexpr size_t first_block_size = 4 * 1024;
+	static constexpr size_t largest_block_size = 64 * 1024;
+
+	void* allocate(size_t size, size_t alignment);
+	// makes the next block at least this large
+	void reserve(size_t size) {
+		next_block_size = std::max(next_block_size, size);
+	}
+
+	template<typename T, typename ...Params>
+	std::unique_ptr<T> make(Params&&... params) {
+		static_assert(std::is_base_of_v<element_base, T>);
+		static_assert(alignof(T) <= alignof(std::max_align_t));
+		auto ptr = new (allocate(sizeof(T), alignof(T))) T(std::forward<Params>(params)...);
+		ptr->flags |= element_base::is_arena_allocated_mask;
+		return std::unique_ptr<T>(ptr);
+	}
+
+	size_t allocation_count() const {
+		return allocations;
+	}
+	size_t bytes_used() const {
+		return used;
+	}
+	size_t bytes_reserved() const {
+		return reserved;
+	}
 };
 
 
@@ -36,6 +36,31 @@ mouse_probe container_base::impl_probe_mouse(sys::state& state, int32_t x, int32
 	return element_base::impl_probe_mouse(state, x, y, type);
 }
 
+void probe_self_combined(sys::state& state, element_base& self, int32_t x, int32_t y, mouse_probe_set& probes) noexcept {
+	if(!probes.click.under_mouse) {
+		auto r = self.element_base::impl_probe_mouse(state, x, y, mouse_probe_type::click);
+		if(r.under_mouse)
+			probes.click = r;
+	}
+	if(!probes.tooltip.under_mouse) {
+		auto r = self.element_base::impl_probe_mouse(state, x, y, mouse_probe_type::tooltip);
+		if(r.under_mouse)
+			probes.tooltip = r;
+	}
+}
+
+void container_base::impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept {
+	for(auto& c : children) {
+		if(c->is_visible()) {
+			auto relative_location = child_relative_location(state, *this, *c);
+			c->impl_probe_mouse_combined(state, x - relative_location.x, y - relative_location.y, probes);
+			if(probes.complete())
+				return;
+		}
+	}
+	probe_self_combined(state, *this, x, y, probes);
+}
+
 drag_and_drop_query_result container_base::impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept {
 	for(auto& c : children) {
 		if(c->is_visible()) {
@@ -48,7 +73,86 @@ drag_and_drop_query_result container_base::impl_drag_and_drop_query(sys::state&
 	return element_base::impl_drag_and_drop_query(state, x, y, data_type);
 }
 
+void child_hit_grid::build(sys::state& state, non_owning_container_base& container) {
+	rects.clear();
+	cell_starts.clear();
+	cell_items.clear();
+
+	built_size = container.base_data.size;
+	for(auto c : container.children) {
+		rects.push_back(urect{ child_relative_location(state, container, *c), c->base_data.size });
+	}
+
+	// aim for a handful of children per cell
+	auto const target_cells = std::max(size_t(1), rects.size() / 4);
+	auto const side = std::max(1, int32_t(std::sqrt(double(target_cells))));
+	cells_x = std::clamp(side, 1, std::max(1, int32_t(built_size.x)));
+	cells_y = std::clamp(side, 1, std::max(1, int32_t(built_size.y)));
+	cell_width = std::max(1, (int32_t(built_size.x) + cells_x - 1) / cells_x);
+	cell_height = std::max(1, (int32_t(built_size.y) + cells_y - 1) / cells_y);
+
+	auto for_each_cell = [&](urect const& r, auto&& f) {
+		auto x0 = std::max(0, int32_t(r.top_left.x));
+		auto y0 = std::max(0, int32_t(r.top_left.y));
+		auto x1 = std::min(int32_t(built_size.x), int32_t(r.top_left.x) + int32_t(r.size.x));
+		auto y1 = std::min(int32_t(built_size.y), int32_t(r.top_left.y) + int32_t(r.size.y));
+		if(x0 >= x1 || y0 >= y1)
+			return; // can't contain any point inside the container
+		for(int32_t cy = y0 / cell_height; cy <= (y1 - 1) / cell_height; ++cy) {
+			for(int32_t cx = x0 / cell_width; cx <= (x1 - 1) / cell_width; ++cx) {
+				f(uint32_t(cy * cells_x + cx));
+			}
+		}
+	};
+
+	// counting sort of children into cells; filling in child order keeps each cell's list ascending
+	cell_starts.resize(size_t(cells_x * cells_y) + 1, 0);
+	for(auto& r : rects)
+		for_each_cell(r, [&](uint32_t cell) { ++cell_starts[cell + 1]; });
+	for(size_t i = 1; i < cell_starts.size(); ++i)
+		cell_starts[i] += cell_starts[i - 1];
+	cell_items.resize(cell_starts.back());
+	std::vector<uint32_t> fill(cell_starts.begin(), cell_starts.end() - 1);
+	for(uint32_t i = 0; i < uint32_t(rects.size()); ++i)
+		for_each_cell(rects[i], [&](uint32_t cell) { cell_items[fill[cell]++] = i; });
+
+	valid = true;
+}
+
+std::pair<uint32_t const*, uint32_t const*> child_hit_grid::candidates(int32_t x, int32_t y) const {
+	auto cell = uint32_t((y / cell_height) * cells_x + (x / cell_width));
+	return std::pair<uint32_t const*, uint32_t const*>(cell_items.data() + cell_starts[cell], cell_items.data() + cell_starts[cell + 1]);
+}
+
+bool non_owning_container_base::hit_grid_candidates(sys::state& state, int32_t x, int32_t y, uint32_t const*& first, uint32_t const*& last) noexcept {
+	if(!use_hit_grid || children.size() < child_hit_grid::minimum_children)
+		return false;
+	if(x < 0 || y < 0 || x >= base_data.size.x || y >= base_data.size.y)
+		return false;
+	if(!hit_grid.valid || hit_grid.rects.size() != children.size() || hit_grid.built_size.x != base_data.size.x || hit_grid.built_size.y != base_data.size.y)
+		hit_grid.build(state, *this);
+	auto r = hit_grid.candidates(x, y);
+	first = r.first;
+	last = r.second;
+	return true;
+}
+
 mouse_probe non_owning_container_base::impl_probe_mouse(sys::state& state, int32_t x, int32_t y, mouse_probe_type type) noexcept {
+	uint32_t const* first = nullptr;
+	uint32_t const* last = nullptr;
+	if(hit_grid_candidates(state, x, y, first, last)) {
+		for(; first != last; ++first) {
+			auto c = children[*first];
+			if(c->is_visible() && hit_grid.contains(*first, x, y)) {
+				auto& r = hit_grid.rects[*first];
+				auto res = c->impl_probe_mouse(state, x - r.top_left.x, y - r.top_left.y, type);
+				if(res.under_mouse)
+					return res;
+			}
+		}
+		return element_base::impl_probe_mouse(state, x, y, type);
+	}
+
 	for(auto& c : children) {
 		if(c->is_visible()) {
 			auto relative_location = child_relative_location(state, *this, *c);
@@ -60,7 +164,50 @@ mouse_probe non_owning_container_base::impl_probe_mouse(sys::state& state, int32
 	return element_base::impl_probe_mouse(state, x, y, type);
 }
 
+void non_owning_container_base::impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept {
+	uint32_t const* first = nullptr;
+	uint32_t const* last = nullptr;
+	if(hit_grid_candidates(state, x, y, first, last)) {
+		for(; first != last; ++first) {
+			auto c = children[*first];
+			if(c->is_visible() && hit_grid.contains(*first, x, y)) {
+				auto& r = hit_grid.rects[*first];
+				c->impl_probe_mouse_combined(state, x - r.top_left.x, y - r.top_left.y, probes);
+				if(probes.complete())
+					return;
+			}
+		}
+		probe_self_combined(state, *this, x, y, probes);
+		return;
+	}
+
+	for(auto& c : children) {
+		if(c->is_visible()) {
+			auto relative_location = child_relative_location(state, *this, *c);
+			c->impl_probe_mouse_combined(state, x - relative_location.x, y - relative_location.y, probes);
+			if(probes.complete())
+				return;
+		}
+	}
+	probe_self_combined(state, *this, x, y, probes);
+}
+
 drag_and_drop_query_result non_owning_container_base::impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept {
+	uint32_t const* first = nullptr;
+	uint32_t const* last = nullptr;
+	if(hit_grid_candidates(state, x, y, first, last)) {
+		for(; first != last; ++first) {
+			auto c = children[*first];
+			if(c->is_visible() && hit_grid.contains(*first, x, y)) {
+				auto& r = hit_grid.rects[*first];
+				auto res = c->impl_drag_and_drop_query(state, x - r.top_left.x, y - r.top_left.y, data_type);
+				if(res.under_mouse)
+					return res;
+			}
+		}
+		return element_base::impl_drag_and_drop_query(state, x, y, data_type);
+	}
+
 	for(auto& c : children) {
 		if(c->is_visible()) {
 			auto relative_location = child_relative_location(state, *this, *c);
@@ -95,24 +242,42 @@ message_result non_owning_container_base::impl_on_key_down(sys::state& state, sy
 	return greater_result(res, element_base::impl_on_key_down(state, key, mods));
 }
 
+// containers skip children whose subtree reads none of the channels being refreshed, and rebuild their own subtree
+// mask from the children as they go
 void container_base::impl_on_update(sys::state& state) noexcept {
-	on_update(state);
+	auto channels = state.ui_state.active_update_channels;
+	if((update_dependencies & channels) != 0) {
+		on_update(state);
+		invalidate_render_cache(*this);
+	}
 	if(is_visible()) {
+		auto subtree = update_dependencies;
 		for(auto& c : children) {
 			if(c->is_visible() || (c->flags & element_base::wants_update_when_hidden_mask) != 0) {
-				c->impl_on_update(state);
+				if((c->subtree_update_dependencies & channels) != 0)
+					c->impl_on_update(state);
 			}
+			subtree |= c->subtree_update_dependencies;
 		}
+		subtree_update_dependencies = subtree;
 	}
 }
 void non_owning_container_base::impl_on_update(sys::state& state) noexcept {
-	on_update(state);
+	auto channels = state.ui_state.active_update_channels;
+	if((update_dependencies & channels) != 0) {
+		on_update(state);
+		invalidate_render_cache(*this);
+	}
 	if(is_visible()) {
+		auto subtree = update_dependencies;
 		for(size_t i = children.size(); i-- > 0;) {
 			if(children[i]->is_visible() || (children[i]->flags & element_base::wants_update_when_hidden_mask) != 0) {
-				children[i]->impl_on_update(state);
+				if((children[i]->subtree_update_dependencies & channels) != 0)
+					children[i]->impl_on_update(state);
 			}
+			subtree |= children[i]->subtree_update_dependencies;
 		}
+		subtree_update_dependencies = subtree;
 	}
 }
 void container_base::impl_on_reset_text(sys::state& state) noexcept {
@@ -120,14 +285,59 @@ void container_base::impl_on_reset_text(sys::state& state) noexcept {
 		c->impl_on_reset_text(state);
 	}
 	on_reset_text(state);
+	invalidate_render_cache(*this);
+}
+void container_base::impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	for(auto& c : children) {
+		c->impl_on_queue_text_shaping(state, batch);
+	}
+	on_queue_text_shaping(state, batch);
 }
 void non_owning_container_base::impl_on_reset_text(sys::state& state) noexcept {
 	for(auto& c : children) {
 		c->impl_on_reset_text(state);
 	}
 	on_reset_text(state);
+	invalidate_render_cache(*this);
+}
+void non_owning_container_base::impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept {
+	for(auto& c : children) {
+		c->impl_on_queue_text_shaping(state, batch);
+	}
+	on_queue_text_shaping(state, batch);
 }
+// a subtree can be drawn from its cache unless it has changed or holds the focused edit box, which keeps animating its cursor.
+// inside another capture it is drawn directly, since the enclosing cache already keeps it and nested windows would
+// otherwise each hold a framebuffer of their own
+template<typename T>
+void render_retained(sys::state& state, T& container, int32_t x, int32_t y) noexcept {
+	bool holds_focus = false;
+	for(element_base* i = state.ui_state.edit_target_internal; i; i = i->parent) {
+		if(i == &container) {
+			holds_focus = true;
+			break;
+		}
+	}
+	if(holds_focus || state.open_gl.ui_target_height != 0 || container.base_data.size.x <= 0 || container.base_data.size.y <= 0) {
+		container.render_contents(state, x, y);
+		return;
+	}
+	if((container.flags & element_base::render_cache_dirty_mask) != 0 || !container.render_cache.is_ready_for(state, container.base_data.size.x, container.base_data.size.y)) {
+		container.render_cache.begin(state, container.base_data.size.x, container.base_data.size.y);
+		container.render_contents(state, 0, 0);
+		container.render_cache.end(state);
+		container.flags &= ~element_base::render_cache_dirty_mask;
+	}
+	container.render_cache.render(state, x, y);
+}
+
 void container_base::impl_render(sys::state& state, int32_t x, int32_t y) noexcept {
+	if(retain_render)
+		render_retained(state, *this, x, y);
+	else
+		render_contents(state, x, y);
+}
+void container_base::render_contents(sys::state& state, int32_t x, int32_t y) noexcept {
 	element_base::impl_render(state, x, y);
 
 	for(size_t i = children.size(); i-- > 0;) {
@@ -138,6 +348,12 @@ void container_base::impl_render(sys::state& state, int32_t x, int32_t y) noexce
 	}
 }
 void non_owning_container_base::impl_render(sys::state& state, int32_t x, int32_t y) noexcept {
+	if(retain_render)
+		render_retained(state, *this, x, y);
+	else
+		render_contents(state, x, y);
+}
+void non_owning_container_base::render_contents(sys::state& state, int32_t x, int32_t y) noexcept {
 	element_base::impl_render(state, x, y);
 
 	for(size_t i = children.size(); i-- > 0;) {
@@ -155,6 +371,7 @@ std::unique_ptr<element_base> container_base::remove_child(element_base* child)
 		auto temp = std::move(children.back());
 		children.pop_back();
 		temp->parent = nullptr;
+		invalidate_render_cache(*this);
 		return temp;
 	}
 	return std::unique_ptr<element_base>{};
@@ -164,24 +381,30 @@ void container_base::move_child_to_front(element_base* child) noexcept {
 		if(it != children.begin())
 			std::rotate(children.begin(), it, it + 1);
 	}
+	invalidate_render_cache(*this);
 }
 void non_owning_container_base::move_child_to_front(element_base* child) noexcept {
 	if(auto it = std::find_if(children.begin(), children.end(), [child](element_base* p) { return p == child; }); it != children.end()) {
 		if(it != children.begin())
 			std::rotate(children.begin(), it, it + 1);
 	}
+	hit_grid.valid = false;
+	invalidate_render_cache(*this);
 }
 void container_base::move_child_to_back(element_base* child) noexcept {
 	if(auto it = std::find_if(children.begin(), children.end(), [child](std::unique_ptr<element_base>& p) { return p.get() == child; }); it != children.end()) {
 		if(it + 1 != children.end())
 			std::rotate(it, it + 1, children.end());
 	}
+	invalidate_render_cache(*this);
 }
 void non_owning_container_base::move_child_to_back(element_base* child) noexcept {
 	if(auto it = std::find_if(children.begin(), children.end(), [child](element_base* p) { return p == child; }); it != children.end()) {
 		if(it + 1 != children.end())
 			std::rotate(it, it + 1, children.end());
 	}
+	hit_grid.valid = false;
+	invalidate_render_cache(*this);
 }
 void container_base::add_child_to_front(std::unique_ptr<element_base> child) noexcept {
 	child->parent = this;
@@ -189,10 +412,14 @@ void container_base::add_child_to_front(std::unique_ptr<element_base> child) noe
 	if(children.size() > 1) {
 		std::rotate(children.begin(), children.end() - 1, children.end());
 	}
+	invalidate_render_cache(*this);
+	invalidate_update_dependencies(*this);
 }
 void container_base::add_child_to_back(std::unique_ptr<element_base> child) noexcept {
 	child->parent = this;
 	children.emplace_back(std::move(child));
+	invalidate_render_cache(*this);
+	invalidate_update_dependencies(*this);
 }
 element_base* container_base::get_child_by_index(sys::state const& state, int32_t index) noexcept {
 	if(0 <= index && index < int32_t(children.size()))
@@ -221,7 +448,7 @@ uint32_t internal_get_disabled_color(float r, float g, float b) {
 
 void render_text_chunk(
 	sys::state& state,
-	text::text_chunk t,
+	text::text_chunk const& t,
 	float x,
 	float baseline_y,
 	uint16_t font_id,
@@ -250,7 +477,8 @@ void render_text_chunk(
 			x,
 			baseline_y,
 			text_color,
-			font_id
+			font_id,
+			t.effect
 		);
 	}
 }
@@ -380,40 +608,35 @@ sys::text_mouse_test_result edit_box_element_base::detailed_text_mouse_test(sys:
 
 	int32_t best_fit = -1;
 	uint32_t quadrent = 3;
-	int32_t distance_from_fit = 0;
 
-	for(size_t i = glyph_details.grapheme_placement.size(); i-- > 0; ) {
-		auto& gi = glyph_details.grapheme_placement[i];
-		if(gi.line == line) {
-			if(gi.x_offset <= xpos && xpos <= gi.x_offset + gi.width) {
-				best_fit = int32_t(gi.source_offset);
-				if(gi.x_offset + gi.width / 4 < xpos)
-					quadrent = 2;
-				else if(gi.x_offset + gi.width / 2 < xpos)
-					quadrent = 3;
-				else if(gi.x_offset + (gi.width * 3) / 4 < xpos) {
-					quadrent = 0;
-					++best_fit;
-				} else {
-					quadrent = 1;
-					++best_fit;
-				}
-				break;
-			}
-			if(xpos < gi.x_offset) {
-				if(best_fit == -1 || (gi.x_offset - xpos) < distance_from_fit) {
-					best_fit = int32_t(gi.source_offset);
-					distance_from_fit = int32_t(gi.x_offset - xpos);
-					quadrent = 2;
-				}
-			}
-			if(xpos >= gi.x_offset + gi.width) {
-				if(best_fit == -1 || ((xpos + 1) - (gi.x_offset + gi.width)) < distance_from_fit) {
-					best_fit = int32_t(gi.source_offset + 1);
-					distance_from_fit = int32_t((xpos + 1) - (gi.x_offset + gi.width));
-					quadrent = 1;
-				}
+	auto hit = glyph_details.hit_test_line(line, xpos);
+	if(hit.index != -1) {
+		auto& gi = glyph_details.grapheme_placement[hit.index];
+		switch(hit.type) {
+		case text::grapheme_hit::position::inside:
+			best_fit = int32_t(gi.source_offset);
+			if(gi.x_offset + gi.width / 4 < xpos)
+				quadrent = 2;
+			else if(gi.x_offset + gi.width / 2 < xpos)
+				quadrent = 3;
+			else if(gi.x_offset + (gi.width * 3) / 4 < xpos) {
+				quadrent = 0;
+				++best_fit;
+			} else {
+				quadrent = 1;
+				++best_fit;
 			}
+			break;
+		case text::grapheme_hit::position::before:
+			best_fit = int32_t(gi.source_offset);
+			quadrent = 2;
+			break;
+		case text::grapheme_hit::position::after:
+			best_fit = int32_t(gi.source_offset + 1);
+			quadrent = 1;
+			break;
+		default:
+			break;
 		}
 	}
 	return sys::text_mouse_test_result{ uint32_t(best_fit != -1 ? best_fit : 0), quadrent };
@@ -689,8 +912,8 @@ void edit_box_element_base::internal_on_text_changed(sys::state& state) {
 
 	//TODO multiline must save and restore visible line
 	if(template_id != -1) {
-		glyph_details.grapheme_placement.clear();
-		glyph_details.total_lines = 0;
+		auto reshape_start = std::chrono::steady_clock::now();
+		glyph_details.clear();
 
 		internal_layout.contents.clear();
 		internal_layout.number_of_lines = 0;
@@ -700,9 +923,16 @@ void edit_box_element_base::internal_on_text_changed(sys::state& state) {
 		auto al = alice_ui::convert_align(state.ui_templates.button_t[template_id].primary.h_text_alignment);
 		auto fh = text::make_font_id(state, state.ui_templates.button_t[template_id].primary.font_choice == 1, state.ui_templates.button_t[template_id].primary.font_scale * par->grid_size * 2);
 
-		text::single_line_layout sl{ internal_layout, text::layout_parameters{ 0, 0, static_cast<int16_t>(base_data.size.x - hmargin * 2), static_cast<int16_t>(base_data.size.y), fh, 0, al, text::text_color::black, true, true }, state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
-		sl.edit_details = &glyph_details;
-		sl.add_text(state, cached_text);
+		shaping_cache.begin_pass(state, fh);
+		{
+			text::single_line_layout sl{ internal_layout, text::layout_parameters{ 0, 0, static_cast<int16_t>(base_data.size.x - hmargin * 2), static_cast<int16_t>(base_data.size.y), fh, 0, al, text::text_color::black, true, true }, state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
+			sl.edit_details = &glyph_details;
+			sl.chunk_cache = &shaping_cache;
+			sl.add_text(state, cached_text);
+			glyph_details.build_index();
+		}
+		shaping_cache.end_pass();
+		last_reshape_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - reshape_start);
 	} 
 
 	// TODO accessibility integration
@@ -876,7 +1106,8 @@ ui::urect edit_box_element_base::text_bounds(sys::state& state, int32_t position
 
 	auto abs_pos = ui::get_absolute_location(state, *this);
 
-	for(auto j = glyph_details.grapheme_placement.size(); j-- > 0;) {
+	auto candidates = glyph_details.clusters_for_source_range(position_start, position_end);
+	for(auto j = candidates.second; j-- > candidates.first;) {
 		if(position_start <= glyph_details.grapheme_placement[j].source_offset && glyph_details.grapheme_placement[j].source_offset <= position_end) {
 			if(first) {
 				left = glyph_details.grapheme_placement[j].x_offset;
@@ -915,32 +1146,23 @@ ui::urect edit_box_element_base::text_bounds(sys::state& state, int32_t position
 	}
 }
 int32_t edit_box_element_base::best_cursor_fit_on_line(int32_t line, int32_t xpos) {
-	int32_t best_fit = -1;
-	int32_t distance_from_fit = 0;
-	for(size_t i = glyph_details.grapheme_placement.size(); i-- > 0; ) {
-		auto& gi = glyph_details.grapheme_placement[i];
-		if(gi.line == line) {
-			if(gi.x_offset <= xpos && xpos <= gi.x_offset + gi.width) {
-				if(gi.x_offset + gi.width / 2 < xpos)
-					return int32_t(i + (gi.has_rtl_directionality() ? 0 : 1));
-				else
-					return int32_t(i + (gi.has_rtl_directionality() ? 1 : 0));
-			}
-			if(xpos < gi.x_offset) {
-				if(best_fit == -1 || (gi.x_offset - xpos) < distance_from_fit) {
-					best_fit = int32_t(i + (gi.has_rtl_directionality() ? 1 : 0));
-					distance_from_fit = int32_t(gi.x_offset - xpos);
-				}
-			}
-			if(xpos >= gi.x_offset + gi.width) {
-				if(best_fit == -1 || ((xpos + 1) - (gi.x_offset + gi.width)) < distance_from_fit) {
-					best_fit = int32_t(i + (gi.has_rtl_directionality() ? 0 : 1));
-					distance_from_fit = int32_t((xpos + 1) - (gi.x_offset + gi.width));
-				}
-			}
-		}
+	auto hit = glyph_details.hit_test_line(line, xpos);
+	if(hit.index == -1)
+		return -1;
+	auto& gi = glyph_details.grapheme_placement[hit.index];
+	switch(hit.type) {
+	case text::grapheme_hit::position::inside:
+		if(gi.x_offset + gi.width / 2 < xpos)
+			return hit.index + (gi.has_rtl_directionality() ? 0 : 1);
+		else
+			return hit.index + (gi.has_rtl_directionality() ? 1 : 0);
+	case text::grapheme_hit::position::before:
+		return hit.index + (gi.has_rtl_directionality() ? 1 : 0);
+	case text::grapheme_hit::position::after:
+		return hit.index + (gi.has_rtl_directionality() ? 0 : 1);
+	default:
+		return -1;
 	}
-	return best_fit;
 }
 int32_t edit_box_element_base::visually_left_on_line(int32_t line) {
 	for(size_t i = glyph_details.grapheme_placement.size(); i-- > 0; ) {
@@ -1640,13 +1862,13 @@ void edit_box_element_base::on_edit_command(sys::state& state, edit_command comm
 	}
 }
 void edit_box_element_base::set_text(sys::state& state, std::u16string const& new_text) {
+	invalidate_render_cache(*this);
 	if(template_id != -1) {
 		if(new_text != cached_text) {
 			alice_ui::grid_size_window* par = static_cast<alice_ui::grid_size_window*>(parent);
 			auto hmargin = state.ui_templates.button_t[template_id].primary.h_text_margins * par->grid_size;
 
-			glyph_details.grapheme_placement.clear();
-			glyph_details.total_lines = 0;
+			glyph_details.clear();
 
 			if(!changes_made)
 				edit_undo_buffer.push_state(undo_item{ cached_text, int16_t(anchor_position), int16_t(cursor_position), true });
@@ -1661,8 +1883,12 @@ void edit_box_element_base::set_text(sys::state& state, std::u16string const& ne
 				text::single_line_layout sl{ internal_layout, text::layout_parameters{ 0, 0, static_cast<int16_t>(base_data.size.x - hmargin* 2), static_cast<int16_t>(base_data.size.y),
 							fonthandle, 0, al, text::text_color::black, true, true },
 					state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? text::layout_base::rtl_status::rtl : text::layout_base::rtl_status::ltr };
+				shaping_cache.begin_pass(state, fonthandle);
 				sl.edit_details = &glyph_details;
+				sl.chunk_cache = &shaping_cache;
 				sl.add_text(state, cached_text);
+				glyph_details.build_index();
+				shaping_cache.end_pass();
 			}
 		}
 	}
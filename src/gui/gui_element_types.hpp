@@ -19,7 +19,7 @@ namespace ui {
 
 void render_text_chunk(
 	sys::state& state,
-	text::text_chunk t,
+	text::text_chunk const& t,
 	float x,
 	float baseline_y,
 	uint16_t font_id,
@@ -31,13 +31,19 @@ void render_text_chunk(
 class container_base : public element_base {
 public:
 	std::vector<std::unique_ptr<element_base>> children;
+	ogl::retained_render render_cache;
+	bool retain_render = false; // draw the subtree from a cached framebuffer until something in it changes
+
+	void render_contents(sys::state& state, int32_t x, int32_t y) noexcept;
 
 	mouse_probe impl_probe_mouse(sys::state& state, int32_t x, int32_t y, mouse_probe_type type) noexcept override;
+	void impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept override;
 	message_result impl_on_key_down(sys::state& state, sys::virtual_key key, sys::key_modifiers mods) noexcept final;
 	void impl_on_update(sys::state& state) noexcept override;
 
 	void impl_render(sys::state& state, int32_t x, int32_t y) noexcept override;
 	void impl_on_reset_text(sys::state& state) noexcept override;
+	void impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	drag_and_drop_query_result impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept override;
 
 	std::unique_ptr<element_base> remove_child(element_base* child) noexcept final;
@@ -48,16 +54,54 @@ public:
 	element_base* get_child_by_index(sys::state const& state, int32_t index) noexcept final;
 };
 
+class non_owning_container_base;
+
+// uniform grid over a container's child rectangles. a point inside the container only has to be tested against the
+// children overlapping its cell, which are listed in child order so the first hit is the same as in a linear scan.
+// it only sees the children's own rectangles, so it is meant for containers whose children are laid out inside
+// their bounds (such as layout windows), and has to be invalidated whenever they are moved
+struct child_hit_grid {
+	std::vector<urect> rects;
+	std::vector<uint32_t> cell_starts;
+	std::vector<uint32_t> cell_items;
+	xy_pair built_size{ 0, 0 };
+	int32_t cells_x = 0;
+	int32_t cells_y = 0;
+	int32_t cell_width = 1;
+	int32_t cell_height = 1;
+	bool valid = false;
+
+	static constexpr size_t minimum_children = 16;
+
+	void build(sys::state& state, non_owning_container_base& container);
+	std::pair<uint32_t const*, uint32_t const*> candidates(int32_t x, int32_t y) const;
+	bool contains(uint32_t child, int32_t x, int32_t y) const {
+		auto& r = rects[child];
+		return r.top_left.x <= x && x < r.top_left.x + r.size.x && r.top_left.y <= y && y < r.top_left.y + r.size.y;
+	}
+};
+
 class non_owning_container_base : public element_base {
 public:
 	std::vector<element_base*> children;
+	child_hit_grid hit_grid;
+	ogl::retained_render render_cache;
+	bool use_hit_grid = false;
+	bool retain_render = false; // draw the subtree from a cached framebuffer until something in it changes
+
+	void render_contents(sys::state& state, int32_t x, int32_t y) noexcept;
+
+	// returns false if the grid can't answer for this point and the children have to be scanned
+	bool hit_grid_candidates(sys::state& state, int32_t x, int32_t y, uint32_t const*& first, uint32_t const*& last) noexcept;
 
 	mouse_probe impl_probe_mouse(sys::state& state, int32_t x, int32_t y, mouse_probe_type type) noexcept override;
+	void impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept override;
 	message_result impl_on_key_down(sys::state& state, sys::virtual_key key, sys::key_modifiers mods) noexcept final;
 	void impl_on_update(sys::state& state) noexcept override;
 
 	void impl_render(sys::state& state, int32_t x, int32_t y) noexcept override;
 	void impl_on_reset_text(sys::state& state) noexcept override;
+	void impl_on_queue_text_shaping(sys::state& state, text::shaping_batch& batch) noexcept override;
 	drag_and_drop_query_result impl_drag_and_drop_query(sys::state& state, int32_t x, int32_t y, ui::drag_and_drop_data data_type) noexcept override;
 
 	void move_child_to_front(element_base* child) noexcept final;
@@ -141,6 +185,8 @@ protected:
 	}
 
 	text::layout_details glyph_details;
+	text::shaped_chunk_cache shaping_cache;
+	std::chrono::microseconds last_reshape_time{ 0 }; // how long laying out the text took after the last edit
 	std::chrono::time_point<std::chrono::steady_clock> activation_time;
 	window::text_services_object* ts_obj = nullptr;
 
@@ -205,15 +251,18 @@ public:
 
 class tool_tip : public element_base {
 public:
+	std::pmr::monotonic_buffer_resource layout_memory{ 16 * 1024 };
 	text::layout internal_layout;
-	tool_tip() { }
+	tool_tip() {
+		internal_layout.transient_memory = &layout_memory;
+	}
 	void render(sys::state& state, int32_t x, int32_t y) noexcept override;
 };
 
 
 void render_text_chunk(
 	sys::state& state,
-	text::text_chunk t,
+	text::text_chunk const& t,
 	float x,
 	float baseline_y,
 	uint16_t font_id,
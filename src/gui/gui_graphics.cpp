@@ -83,30 +83,85 @@ mouse_probe element_base::impl_probe_mouse(sys::state& state, int32_t x, int32_t
 	}
 	return probe_result;
 }
+void element_base::impl_probe_mouse_combined(sys::state& state, int32_t x, int32_t y, mouse_probe_set& probes) noexcept {
+	if(!probes.click.under_mouse) {
+		auto r = impl_probe_mouse(state, x, y, mouse_probe_type::click);
+		if(r.under_mouse)
+			probes.click = r;
+	}
+	if(!probes.tooltip.under_mouse) {
+		auto r = impl_probe_mouse(state, x, y, mouse_probe_type::tooltip);
+		if(r.under_mouse)
+			probes.tooltip = r;
+	}
+}
+// the element receiving a click or scroll usually changes how it looks, so it also drops any cached rendering of it
 message_result element_base::impl_on_lbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
+	invalidate_render_cache(*this);
 	return on_lbutton_down(state, x, y, mods);
 }
 message_result element_base::impl_on_lbutton_up(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods, bool under_mouse) noexcept {
+	invalidate_render_cache(*this);
 	return on_lbutton_up(state, x, y, mods, under_mouse);
 }
 message_result element_base::impl_on_rbutton_down(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
+	invalidate_render_cache(*this);
 	return on_rbutton_down(state, x, y, mods);
 }
 message_result element_base::impl_on_key_down(sys::state& state, sys::virtual_key key, sys::key_modifiers mods) noexcept {
-	return on_key_down(state, key, mods);
+	auto result = on_key_down(state, key, mods);
+	if(result != message_result::unseen)
+		invalidate_render_cache(*this);
+	return result;
 }
 message_result element_base::impl_on_scroll(sys::state& state, int32_t x, int32_t y, float amount,
 		sys::key_modifiers mods) noexcept {
+	invalidate_render_cache(*this);
 	return on_scroll(state, x, y, amount, mods);
 }
 message_result element_base::impl_on_mouse_move(sys::state& state, int32_t x, int32_t y, sys::key_modifiers mods) noexcept {
 	return on_mouse_move(state, x, y, mods);
 }
 void element_base::impl_on_update(sys::state& state) noexcept {
-	on_update(state);
+	if((update_dependencies & state.ui_state.active_update_channels) != 0) {
+		on_update(state);
+		invalidate_render_cache(*this);
+	}
+	subtree_update_dependencies = update_dependencies;
 }
 void element_base::impl_on_reset_text(sys::state& state) noexcept {
 	on_reset_text(state);
+	invalidate_render_cache(*this);
+}
+void* element_arena::allocate(size_t size, size_t alignment) {
+	if(blocks.empty() || ((blocks.back().used + alignment - 1) & ~(alignment - 1)) + size > blocks.back().size) {
+		auto new_size = std::max(next_block_size, size);
+		blocks.push_back(block{ std::unique_ptr<std::byte[]>(new std::byte[new_size]), new_size, 0 });
+		reserved += new_size;
+		next_block_size = std::min(largest_block_size, new_size * 2);
+	}
+	auto& b = blocks.back();
+	auto offset = (b.used + alignment - 1) & ~(alignment - 1);
+	b.used = offset + size;
+	used += size;
+	++allocations;
+	return b.memory.get() + offset;
+}
+void update_all_channels(sys::state& state, element_base& e) noexcept {
+	auto prior = state.ui_state.active_update_channels;
+	state.ui_state.active_update_channels = sys::all_update_channels;
+	e.impl_on_update(state);
+	state.ui_state.active_update_channels = prior;
+}
+void invalidate_update_dependencies(element_base& e) noexcept {
+	for(element_base* i = &e; i; i = i->parent) {
+		i->subtree_update_dependencies = sys::all_update_channels;
+	}
+}
+void invalidate_render_cache(element_base& e) noexcept {
+	for(element_base* i = &e; i; i = i->parent) {
+		i->flags |= element_base::render_cache_dirty_mask;
+	}
 }
 
 message_result element_base::test_mouse(sys::state& state, int32_t x, int32_t y, mouse_probe_type t) noexcept {
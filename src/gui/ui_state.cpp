@@ -44,6 +44,66 @@ void state::set_mouse_sensitive_target(sys::state& state, element_base* target)
 	}
 }
 
+// what the tooltip would add to a layout, hashed without shaping or placing any of it
+uint64_t tooltip_digest(sys::state& state, ui::mouse_probe tooltip_probe, text::layout_parameters const& params) {
+	text::layout scratch;
+	auto probe = text::create_columnar_layout(state, scratch, params, 10);
+	uint64_t digest = 0;
+	probe.content_digest = &digest;
+	probe.digest_only = true;
+	state.ui_state.last_tooltip->update_tooltip(state, tooltip_probe.relative_location.x, tooltip_probe.relative_location.y, probe);
+	return digest;
+}
+
+void state::layout_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int32_t tooltip_sub_index, int16_t max_height, bool reuse_unchanged) {
+	auto params = text::layout_parameters{
+		0, 0, tooltip_width, max_height,
+		default_body_font, 0,
+		text::alignment::left,
+		text::text_color::white,
+		true
+	};
+	auto locale = state.font_collection.get_current_locale();
+
+	if(reuse_unchanged && tooltip_layout.element == last_tooltip && tooltip_layout.sub_index == tooltip_sub_index
+		&& tooltip_layout.max_height == max_height && tooltip_layout.ui_scale == state.user_settings.ui_scale && tooltip_layout.locale == locale) {
+
+		// run the tooltip without laying anything out, and keep the current layout if it would produce the same content
+		if(tooltip_digest(state, tooltip_probe, params) == tooltip_layout.content_digest) {
+			++tooltip_layout_hits;
+			return;
+		}
+		++tooltip_layout_misses;
+	}
+
+	auto container = text::create_columnar_layout(state, tooltip->internal_layout, params, 10);
+	uint64_t digest = 0;
+	container.content_digest = &digest;
+	last_tooltip->update_tooltip(state, tooltip_probe.relative_location.x, tooltip_probe.relative_location.y, container);
+	// the same tooltip, unchanged, has to be recognized the next time, including when its text was wrapped
+	assert(tooltip_digest(state, tooltip_probe, params) == digest);
+	if(container.native_rtl == text::layout_base::rtl_status::rtl) {
+		container.used_width = -container.used_width;
+		for(auto& t : container.base_layout.contents) {
+			t.x += 16 + container.used_width;
+			t.y += 16;
+		}
+	} else {
+		for(auto& t : container.base_layout.contents) {
+			t.x += 16;
+			t.y += 16;
+		}
+	}
+	tooltip->base_data.size.x = int16_t(container.used_width + 32);
+	tooltip->base_data.size.y = int16_t(container.used_height + 32);
+	if(container.used_width > 0)
+		tooltip->set_visible(state, true);
+	else
+		tooltip->set_visible(state, false);
+
+	tooltip_layout = tooltip_layout_key{ last_tooltip, tooltip_sub_index, max_height, state.user_settings.ui_scale, locale, digest };
+}
+
 void state::update_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int32_t tooltip_sub_index, int16_t max_height) {
 	if(last_tooltip != tooltip_probe.under_mouse) return;
 	if(last_tooltip_sub_index != tooltip_sub_index) return;
@@ -52,41 +112,7 @@ void state::update_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int
 
 	auto type = last_tooltip->has_tooltip(state);
 	if(type != ui::tooltip_behavior::position_sensitive_tooltip) {
-		auto container = text::create_columnar_layout(
-			state,
-			tooltip->internal_layout,
-			text::layout_parameters{
-				0, 0,
-				tooltip_width,
-				max_height,
-				default_body_font,
-				0,
-				text::alignment::left,
-				text::text_color::white,
-				true
-			},
-			10
-		);
-		last_tooltip->update_tooltip(state, tooltip_probe.relative_location.x, tooltip_probe.relative_location.y,
-				container);
-		if(container.native_rtl == text::layout_base::rtl_status::rtl) {
-			container.used_width = -container.used_width;
-			for(auto& t : container.base_layout.contents) {
-				t.x += 16 + container.used_width;
-				t.y += 16;
-			}
-		} else {
-			for(auto& t : container.base_layout.contents) {
-				t.x += 16;
-				t.y += 16;
-			}
-		}
-		tooltip->base_data.size.x = int16_t(container.used_width + 32);
-		tooltip->base_data.size.y = int16_t(container.used_height + 32);
-		if(container.used_width > 0)
-			tooltip->set_visible(state, true);
-		else
-			tooltip->set_visible(state, false);
+		layout_tooltip(state, tooltip_probe, tooltip_sub_index, max_height, true);
 	}
 }
 
@@ -100,40 +126,7 @@ void state::populate_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, i
 		if(tooltip_probe.under_mouse) {
 			auto type = last_tooltip->has_tooltip(state);
 			if(type != ui::tooltip_behavior::no_tooltip) {
-				auto container = text::create_columnar_layout(state, tooltip->internal_layout,
-					text::layout_parameters{
-						0, 0, tooltip_width, max_height,
-						default_body_font, 0,
-						text::alignment::left,
-						text::text_color::white,
-						true
-					},
-					10
-				);
-				last_tooltip->update_tooltip(
-					state,
-					tooltip_probe.relative_location.x,
-					tooltip_probe.relative_location.y,
-					container
-				);
-				if(container.native_rtl == text::layout_base::rtl_status::rtl) {
-					container.used_width = -container.used_width;
-					for(auto& t : container.base_layout.contents) {
-						t.x += 16 + container.used_width;
-						t.y += 16;
-					}
-				} else {
-					for(auto& t : container.base_layout.contents) {
-						t.x += 16;
-						t.y += 16;
-					}
-				}
-				tooltip->base_data.size.x = int16_t(container.used_width + 32);
-				tooltip->base_data.size.y = int16_t(container.used_height + 32);
-				if(container.used_width > 0)
-					tooltip->set_visible(state, true);
-				else
-					tooltip->set_visible(state, false);
+				layout_tooltip(state, tooltip_probe, tooltip_sub_index, max_height, false);
 			} else {
 				tooltip->set_visible(state, false);
 			}
@@ -141,37 +134,7 @@ void state::populate_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, i
 			tooltip->set_visible(state, false);
 		}
 	} else if(last_tooltip && last_tooltip->has_tooltip(state) == ui::tooltip_behavior::position_sensitive_tooltip) {
-		auto container = text::create_columnar_layout(
-			state,
-			tooltip->internal_layout,
-			text::layout_parameters{
-				0, 0, tooltip_width, max_height,
-				default_body_font, 0,
-				text::alignment::left,
-				text::text_color::white,
-				true
-			},
-			10
-		);
-		last_tooltip->update_tooltip(state, tooltip_probe.relative_location.x, tooltip_probe.relative_location.y, container);
-		if(container.native_rtl == text::layout_base::rtl_status::rtl) {
-			container.used_width = -container.used_width;
-			for(auto& t : container.base_layout.contents) {
-				t.x += 16 + container.used_width;
-				t.y += 16;
-			}
-		} else {
-			for(auto& t : container.base_layout.contents) {
-				t.x += 16;
-				t.y += 16;
-			}
-		}
-		tooltip->base_data.size.x = int16_t(container.used_width + 32);
-		tooltip->base_data.size.y = int16_t(container.used_height + 32);
-		if(container.used_width > 0)
-			tooltip->set_visible(state, true);
-		else
-			tooltip->set_visible(state, false);
+		layout_tooltip(state, tooltip_probe, tooltip_sub_index, max_height, true);
 	}
 }
 
@@ -8,10 +8,20 @@ namespace ui {
 struct state {
 	element_base* under_mouse = nullptr;
 	element_base* left_mouse_hold_target = nullptr;
+	// hover fades are drawn from the time since the hover changed, so frames keep coming until they are done
+	element_base* hover_fading_out = nullptr; // what the mouse last left, while its fade runs
+	std::chrono::time_point<std::chrono::steady_clock> hover_transition_end{};
+	bool hover_transition_running = false;
 	
 	std::chrono::time_point<std::chrono::steady_clock> last_render_time{};
 	std::chrono::microseconds time_since_last_render{ };
 
+	// layout work done since the current frame started, and the totals for the previous frame
+	uint32_t layout_passes = 0;
+	std::chrono::microseconds layout_time{ 0 };
+	uint32_t last_frame_layout_passes = 0;
+	std::chrono::microseconds last_frame_layout_time{ 0 };
+
 	element_base* scroll_target = nullptr;
 	element_base* drag_target = nullptr;
 	element_base* edit_target_internal = nullptr;
@@ -20,11 +30,26 @@ struct state {
 	xy_pair target_ul_bounds = xy_pair{ 0, 0 };
 	xy_pair target_lr_bounds = xy_pair{ 0, 0 };
 	int32_t last_tooltip_sub_index = -1;
+
+	// what the tooltip on display was laid out for. while these and a digest of the content the element adds stay
+	// the same, refreshing the tooltip keeps the existing layout instead of shaping and breaking its text again
+	struct tooltip_layout_key {
+		element_base* element = nullptr;
+		int32_t sub_index = -1;
+		int16_t max_height = 0;
+		float ui_scale = 0.0f;
+		dcon::locale_id locale;
+		uint64_t content_digest = 0;
+	};
+	tooltip_layout_key tooltip_layout;
+	uint32_t tooltip_layout_hits = 0;   // refreshes that kept the existing layout
+	uint32_t tooltip_layout_misses = 0; // refreshes that found changed content and laid the tooltip out again
 	uint32_t cursor_size = 16;
 	int32_t target_distance = 0;
 	edit_selection_mode selecting_edit_text = edit_selection_mode::none;
 
 	xy_pair relative_mouse_location = xy_pair{ 0, 0 };
+	sys::update_channels active_update_channels = sys::all_update_channels; // what the update in progress has to refresh
 
 	std::unique_ptr<element_base> root;
 
@@ -57,6 +82,7 @@ struct state {
 	void set_focus_target(sys::state& state, element_base* target);
 	void update_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int32_t tooltip_sub_index, int16_t max_height);
 	void populate_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int32_t tooltip_sub_index, int16_t max_height);
+	void layout_tooltip(sys::state& state, ui::mouse_probe tooltip_probe, int32_t tooltip_sub_index, int16_t max_height, bool reuse_unchanged);
 	void reposition_tooltip(ui::urect tooltip_bounds, int16_t root_height, int16_t root_width);
 	void render_tooltip(sys::state& state, bool follow_mouse, int32_t mouse_x, int32_t mouse_y, int32_t screen_size_x, int32_t screen_size_y, float ui_scale);
 
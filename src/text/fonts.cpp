@@ -1,5 +1,8 @@
 #include <cmath>
 #include <bit>
+#include <optional>
+#include <algorithm>
+#include <thread>
 
 #include "hb.h"
 #include "hb-ft.h"
@@ -12,10 +15,14 @@
 #include "constants.hpp"
 #ifdef _WIN32
 #include <icu.h>
+#include <ppl.h>
 #else
+#include "oneapi/tbb.h"
+namespace concurrency = tbb;
 #include <unicode/ubrk.h>
 #include <unicode/utypes.h>
 #include <unicode/ubidi.h>
+#include <unicode/unum.h>
 #endif
 
 namespace text {
@@ -164,6 +171,8 @@ void font_at_size::reset() {
 	hb_font_face = nullptr;
 	hb_buf = nullptr;
 	font_face = nullptr;
+	for(auto& t : numeric_glyphs)
+		t.clear();
 
 	internal_tx_line_height = 0;
 	internal_tx_line_xpos = 1024;
@@ -206,70 +215,26 @@ void font_manager::change_locale(sys::state& state, dcon::locale_id l) {
 	
 	state.world.locale_set_resolved_language(l, hb_language_from_string(localename_sv.data(), int(end_language)));
 
-	{
-		auto f = state.world.locale_get_body_font(l);
-		std::string fname((char const*)f.begin(), (char const*)f.end());
-		font* resolved = nullptr;
-		uint16_t count = 0;
-
-		for(auto& fnt : font_array) {
-			if(fnt.file_name == fname) {
-				resolved = &fnt;
-				break;
-			}
-			++count;
-		}
-
-		if(!resolved) {
-			auto r = simple_fs::get_root(state.common_fs);
-			auto assets = simple_fs::open_directory(r, NATIVE("assets"));
-			auto fonts = simple_fs::open_directory(assets, NATIVE("fonts"));
-			auto ff = simple_fs::open_file(fonts, simple_fs::utf8_to_native(fname));
-			if(!ff) {
-				std::abort();
-			}
-
-			font_array.emplace_back();
-			auto content = simple_fs::view_contents(*ff);
-			load_font(font_array.back(), content.data, content.file_size);
-			font_array.back().file_name = fname;
-			resolved = &(font_array.back());
-		}
-
-		state.world.locale_set_resolved_body_font(l, count);
-	}
-	{
-		auto f = state.world.locale_get_header_font(l);
-		std::string fname((char const*)f.begin(), (char const*)f.end());
-		font* resolved = nullptr;
-		uint16_t count = 0;
-
-		for(auto& fnt : font_array) {
-			if(fnt.file_name == fname) {
-				resolved = &fnt;
-				break;
-			}
-			++count;
-		}
-
-		if(!resolved) {
-			auto r = simple_fs::get_root(state.common_fs);
-			auto assets = simple_fs::open_directory(r, NATIVE("assets"));
-			auto fonts = simple_fs::open_directory(assets, NATIVE("fonts"));
-			auto ff = simple_fs::open_file(fonts, simple_fs::utf8_to_native(fname));
-			if(!ff) {
-				std::abort();
-			}
-
-			font_array.emplace_back();
-			auto content = simple_fs::view_contents(*ff);
-			load_font(font_array.back(), content.data, content.file_size);
-			font_array.back().file_name = fname;
-			resolved = &(font_array.back());
+	auto font_name = [&](auto f) {
+		return std::string((char const*)f.begin(), (char const*)f.end());
+	};
+	auto body_index = find_or_load_font(state, font_name(state.world.locale_get_body_font(l)), true);
+	auto header_index = find_or_load_font(state, font_name(state.world.locale_get_header_font(l)), true);
+	state.world.locale_set_resolved_body_font(l, body_index);
+	state.world.locale_set_resolved_header_font(l, header_index);
+
+	// the fonts of the other locales stand in for scripts that this locale's fonts do not cover
+	fallback_chain.clear();
+	state.world.for_each_locale([&](dcon::locale_id other) {
+		if(other == l)
+			return;
+		for(auto idx : { find_or_load_font(state, font_name(state.world.locale_get_body_font(other)), false), find_or_load_font(state, font_name(state.world.locale_get_header_font(other)), false) }) {
+			if(idx == no_font || idx == body_index || idx == header_index)
+				continue;
+			if(std::find(fallback_chain.begin(), fallback_chain.end(), idx) == fallback_chain.end())
+				fallback_chain.push_back(idx);
 		}
-
-		state.world.locale_set_resolved_header_font(l, count);
-	}
+	});
 
 	state.reset_locale_pool();
 
@@ -328,7 +293,79 @@ void font_manager::change_locale(sys::state& state, dcon::locale_id l) {
 		ubrk_close(ch_it);
 	}
 
+	++break_rules_generation;
+
+	{
+		// separators that only make sense next to the ascii digits the formatters write; anything else keeps the defaults
+		auto usable_separator = [](UChar c) {
+			return c == u'.' || c == u',' || c == u' ' || c == u'\'' || c == 0x00A0 || c == 0x2019 || c == 0x202F;
+		};
+		numbers = number_format{ };
+		std::string icu_name{ localename_sv };
+		std::replace(icu_name.begin(), icu_name.end(), '-', '_');
+		UErrorCode errorCode = U_ZERO_ERROR;
+		UNumberFormat* nf = unum_open(UNUM_DECIMAL, nullptr, 0, icu_name.c_str(), nullptr, &errorCode);
+		if(nf && U_SUCCESS(errorCode)) {
+			UChar decimal[4] = { 0 };
+			UChar group[4] = { 0 };
+			auto decimal_length = unum_getSymbol(nf, UNUM_DECIMAL_SEPARATOR_SYMBOL, decimal, 4, &errorCode);
+			auto group_length = unum_getSymbol(nf, UNUM_GROUPING_SEPARATOR_SYMBOL, group, 4, &errorCode);
+			if(U_SUCCESS(errorCode) && decimal_length == 1 && group_length == 1 && usable_separator(decimal[0]) && usable_separator(group[0]) && decimal[0] != group[0]) {
+				numbers.decimal_point = char16_t(decimal[0]);
+				numbers.group_separator = char16_t(group[0]);
+			}
+		}
+		if(nf)
+			unum_close(nf);
+	}
+
 	state.load_locale_strings(localename_sv);
+	compile_locale_templates(state);
+}
+
+uint16_t font_manager::find_or_load_font(sys::state& state, std::string const& fname, bool required) {
+	if(auto it = font_indices.find(fname); it != font_indices.end())
+		return it->second;
+
+	auto r = simple_fs::get_root(state.common_fs);
+	auto assets = simple_fs::open_directory(r, NATIVE("assets"));
+	auto fonts = simple_fs::open_directory(assets, NATIVE("fonts"));
+	auto ff = simple_fs::open_file(fonts, simple_fs::utf8_to_native(fname));
+	if(!ff) {
+		if(required)
+			std::abort();
+		return no_font;
+	}
+
+	auto index = uint16_t(font_array.size());
+	font_array.emplace_back();
+	auto content = simple_fs::view_contents(*ff);
+	load_font(font_array.back(), content.data, content.file_size);
+	font_array.back().file_name = fname;
+	font_indices.insert_or_assign(fname, index);
+	return index;
+}
+
+uint16_t font_manager::font_for_codepoint(uint16_t primary, char32_t c) const {
+	if(font_array[primary].coverage.empty() || font_array[primary].coverage.covers(c))
+		return primary;
+	for(auto f : fallback_chain) {
+		if(font_array[f].coverage.covers(c))
+			return f;
+	}
+	return primary;
+}
+
+uint16_t font_manager::get_font_index(sys::state& state, font_selection s) {
+	if(!current_locale)
+		std::abort();
+	switch(s) {
+	case font_selection::body_font:
+	default:
+		return uint16_t(state.world.locale_get_resolved_body_font(current_locale));
+	case font_selection::header_font:
+		return uint16_t(state.world.locale_get_resolved_header_font(current_locale));
+	}
 }
 
 font& font_manager::get_font(sys::state& state, font_selection s) {
@@ -379,6 +416,35 @@ void font_manager::load_font(font& fnt, char const* file_data, uint32_t fz) {
 	fnt.file_data = std::unique_ptr<FT_Byte[]>(new FT_Byte[fz]);
 	fnt.file_size = fz;
 	memcpy(fnt.file_data.get(), file_data, fz);
+
+	FT_Face face = nullptr;
+	if(FT_New_Memory_Face(ft_library, fnt.file_data.get(), FT_Long(fz), 0, &face) == 0) {
+		FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+		fnt.coverage.build(face);
+		FT_Done_Face(face);
+	}
+}
+
+void font_coverage::build(FT_Face face) {
+	page_index.assign(codepoint_limit >> 8, uint16_t(0));
+	pages.clear();
+	pages.emplace_back(); // the shared empty page
+	pages.back().fill(0);
+
+	FT_UInt glyph = 0;
+	FT_ULong c = FT_Get_First_Char(face, &glyph);
+	while(glyph != 0) {
+		if(c < codepoint_limit) {
+			auto& slot = page_index[c >> 8];
+			if(slot == 0) {
+				slot = uint16_t(pages.size());
+				pages.emplace_back();
+				pages.back().fill(0);
+			}
+			pages[slot][(c >> 6) & 3] |= uint64_t(1) << (c & 63);
+		}
+		c = FT_Get_Next_Char(face, c, &glyph);
+	}
 }
 
 float font_at_size::line_height(sys::state& state) const {
@@ -395,6 +461,8 @@ float font_at_size::top_adjustment(sys::state& state) const {
 }
 
 bool font::can_display(char32_t ch_in) const {
+	if(!coverage.empty())
+		return coverage.covers(ch_in);
 	if(sized_fonts.empty())
 		return true;
 	return FT_Get_Char_Index(sized_fonts.begin()->second.font_face, ch_in) != 0;
@@ -492,10 +560,36 @@ void font_at_size::make_glyph(uint16_t glyph_in, int32_t subpixel) {
 }
 
 stored_glyphs::stored_glyphs(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, uint32_t details_offset, layout_details* d, uint16_t font_handle) {
-	state.font_collection.get_font(state, type).retrieve_instance(state, size).remake_cache(state, type, *this, s, details_offset, d, font_handle);
+	shape(state, size, type, s, details_offset, d, font_handle);
 }
 stored_glyphs::stored_glyphs(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, no_bidi) {
-	state.font_collection.get_font(state, type).retrieve_instance(state, size).remake_bidiless_cache(state, type, *this, s);
+	shape(state, size, type, s, no_bidi{});
+}
+void stored_glyphs::shape(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, uint32_t details_offset, layout_details* d, uint16_t font_handle) {
+	if(!d && state.font_collection.prepared_shapes) {
+		if(auto r = state.font_collection.prepared_shapes->find(type, int32_t(size * state.user_settings.ui_scale), s, true); r) {
+			clear();
+			glyph_info.assign(r->glyph_info.begin(), r->glyph_info.end());
+			return;
+		}
+	}
+	auto& instance = state.font_collection.get_font(state, type).retrieve_instance(state, size);
+	if(!d && instance.shape_numeric(state, type, *this, s))
+		return;
+	instance.remake_cache(state, type, *this, s, details_offset, d, font_handle);
+}
+void stored_glyphs::shape(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, no_bidi) {
+	if(state.font_collection.prepared_shapes) {
+		if(auto r = state.font_collection.prepared_shapes->find(type, int32_t(size * state.user_settings.ui_scale), s, false); r) {
+			clear();
+			glyph_info.assign(r->glyph_info.begin(), r->glyph_info.end());
+			return;
+		}
+	}
+	auto& instance = state.font_collection.get_font(state, type).retrieve_instance(state, size);
+	if(instance.shape_numeric(state, type, *this, s))
+		return;
+	instance.remake_bidiless_cache(state, type, *this, s);
 }
 
 stored_glyphs::stored_glyphs(stored_glyphs& other, uint32_t offset, uint32_t count) {
@@ -503,35 +597,210 @@ stored_glyphs::stored_glyphs(stored_glyphs& other, uint32_t offset, uint32_t cou
 	std::copy_n(other.glyph_info.data() + offset, count, glyph_info.data());
 }
 
-void font_at_size::remake_cache(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t> source, uint32_t details_offset, layout_details* d, uint16_t font_handle) {
-	txt.glyph_info.clear();
+namespace {
 
-	if(source.size() == 0)
-		return;
+struct icu_thread_pool {
+	uint32_t rules_generation = 0;
+	std::vector<UBreakIterator*> free_iterators[break_type_count];
+	std::vector<std::pair<UBiDi*, int32_t>> free_bidi;
+
+	void drop_iterators() {
+		for(auto& list : free_iterators) {
+			for(auto it : list)
+				ubrk_close(it);
+			list.clear();
+		}
+	}
+	~icu_thread_pool() {
+		drop_iterators();
+		for(auto& b : free_bidi)
+			ubidi_close(b.first);
+	}
+};
+
+thread_local icu_thread_pool icu_pool;
+
+}
+
+break_iterator_lease::break_iterator_lease(sys::state& state, break_type t, char16_t const* text, int32_t length) : type(t) {
+	auto& fc = state.font_collection;
+	rules_generation = fc.break_rules_generation;
+	if(icu_pool.rules_generation != rules_generation) {
+		icu_pool.drop_iterators();
+		icu_pool.rules_generation = rules_generation;
+	}
 
-	auto locale = state.font_collection.get_current_locale();
-	UBiDi* para;
 	UErrorCode errorCode = U_ZERO_ERROR;
+	auto& list = icu_pool.free_iterators[size_t(type)];
+	if(!list.empty()) {
+		it = list.back();
+		list.pop_back();
+		ubrk_setText(it, (UChar const*)text, length, &errorCode);
+	} else {
+		auto& rules = type == break_type::line ? fc.compiled_ubrk_rules : (type == break_type::character ? fc.compiled_char_ubrk_rules : fc.compiled_word_ubrk_rules);
+		it = ubrk_openBinaryRules(rules.data(), int32_t(rules.size()), (UChar const*)text, length, &errorCode);
+	}
+	if(!it || !U_SUCCESS(errorCode)) {
+		std::abort(); // couldn't create iterator
+	}
+}
+break_iterator_lease::~break_iterator_lease() {
+	if(icu_pool.rules_generation == rules_generation)
+		icu_pool.free_iterators[size_t(type)].push_back(it);
+	else
+		ubrk_close(it);
+}
 
-	para = ubidi_open();
-	//para = ubidi_openSized(int32_t(temp_text.size()), 64, pErrorCode);
-	if(!para)
-		std::abort();
+bidi_lease::bidi_lease(int32_t length) {
+	if(!icu_pool.free_bidi.empty()) {
+		std::tie(para, capacity) = icu_pool.free_bidi.back();
+		icu_pool.free_bidi.pop_back();
+	}
+	if(para && capacity < length) {
+		ubidi_close(para);
+		para = nullptr;
+	}
+	if(!para) {
+		UErrorCode errorCode = U_ZERO_ERROR;
+		capacity = std::max(std::max(length, capacity * 2), int32_t(256));
+		para = ubidi_openSized(capacity, 0, &errorCode);
+		if(!para || !U_SUCCESS(errorCode))
+			std::abort();
+	}
+}
+bidi_lease::~bidi_lease() {
+	icu_pool.free_bidi.emplace_back(para, capacity);
+}
 
-	hb_feature_t feature_buffer[10];
-	auto features = type == font_selection::body_font ? state.world.locale_get_body_font_features(locale) :  state.world.locale_get_header_font_features(locale) ;
-	for(uint32_t i = 0; i < uint32_t(std::extent_v<decltype(feature_buffer)>) && i < features.size(); ++i) {
+bool is_all_ltr(std::span<uint16_t const> text) {
+	for(auto c : text) {
+		if(c < 0x0590)
+			continue;
+		if(c <= 0x08FF // hebrew, arabic, syriac, thaana, nko, samaritan, mandaic
+			|| c == 0x200F || (0x202A <= c && c <= 0x202E) || (0x2066 <= c && c <= 0x2069) // bidi controls
+			|| (0xFB1D <= c && c <= 0xFDFF) || (0xFE70 <= c && c <= 0xFEFF) // presentation forms
+			|| c == 0xD802 || c == 0xD803 || c == 0xD83A || c == 0xD83B) // surrogates of the supplementary right to left blocks
+			return false;
+	}
+	return true;
+}
+
+namespace {
+
+uint32_t locale_font_features(sys::state& state, dcon::locale_id locale, font_selection type, hb_feature_t (&feature_buffer)[10]) {
+	auto features = type == font_selection::body_font ? state.world.locale_get_body_font_features(locale) : state.world.locale_get_header_font_features(locale);
+	for(uint32_t i = 0; i < uint32_t(std::extent_v<std::remove_reference_t<decltype(feature_buffer)>>) && i < features.size(); ++i) {
 		feature_buffer[i].tag = features[i];
 		feature_buffer[i].start = 0;
 		feature_buffer[i].end = (unsigned int)-1;
 		feature_buffer[i].value = 1;
 	}
-	uint32_t hb_feature_count = std::min(features.size(), uint32_t(std::extent_v<decltype(feature_buffer)>));
+	return std::min(features.size(), uint32_t(std::extent_v<std::remove_reference_t<decltype(feature_buffer)>>));
+}
 
-	ubidi_setPara(para, (UChar const*)(source.data()), int32_t(source.size()), state.world.locale_get_native_rtl(locale) ? 1 : 0, nullptr, &errorCode);
+struct font_run {
+	int32_t start = 0;
+	int32_t length = 0;
+	uint16_t font = 0;
+};
+
+// glyphs of a run shaped piecewise with more than one font, in visual order
+struct fallback_shaping {
+	std::vector<font_run> runs;
+	std::vector<hb_glyph_info_t> infos;
+	std::vector<hb_glyph_position_t> positions;
+	std::vector<uint16_t> fonts;
+};
+
+bool sticks_to_current_font(char32_t c) {
+	return c == 0x20 || c == 0xA0 || c == 0x200D || (0x0300 <= c && c <= 0x036F) || (0xFE00 <= c && c <= 0xFE0F);
+}
+
+// splits source[start, start + length) into pieces that can each be shaped with one font. returns false when the
+// whole range can be shaped with the primary font, which is the common case
+bool split_by_coverage(font_manager& fm, uint16_t primary, std::span<uint16_t> source, int32_t start, int32_t length, std::vector<font_run>& out) {
+	out.clear();
+	auto end = start + length;
+	for(int32_t i = start; i < end; ) {
+		char32_t c = source[i];
+		int32_t units = 1;
+		if(0xD800 <= c && c <= 0xDBFF && i + 1 < end && 0xDC00 <= source[i + 1] && source[i + 1] <= 0xDFFF) {
+			c = 0x10000 + ((c - 0xD800) << 10) + (char32_t(source[i + 1]) - 0xDC00);
+			units = 2;
+		}
+		if(!out.empty() && sticks_to_current_font(c) && fm.get_font_by_index(out.back().font).coverage.covers(c)) {
+			out.back().length += units;
+		} else {
+			auto f = fm.font_for_codepoint(primary, c);
+			if(!out.empty() && out.back().font == f)
+				out.back().length += units;
+			else
+				out.push_back(font_run{ i, units, f });
+		}
+		i += units;
+	}
+	return !(out.empty() || (out.size() == 1 && out[0].font == primary));
+}
+
+void shape_with_fallback(sys::state& state, font_at_size& primary_instance, uint16_t primary, std::span<uint16_t> source, bool rtl, hb_feature_t const* features, uint32_t feature_count, fallback_shaping& out) {
+	auto locale = state.font_collection.get_current_locale();
+	out.infos.clear();
+	out.positions.clear();
+	out.fonts.clear();
+
+	for(size_t r = 0; r < out.runs.size(); ++r) {
+		// right to left runs come out of harfbuzz in visual order, so their pieces are visited back to front
+		auto& run = out.runs[rtl ? out.runs.size() - 1 - r : r];
+		auto& instance = run.font == primary ? primary_instance : state.font_collection.get_font_by_index(run.font).retrieve_stateless_instance(state.font_collection.ft_library, primary_instance.pixel_size());
+
+		hb_buffer_clear_contents(primary_instance.hb_buf);
+		hb_buffer_add_utf16(primary_instance.hb_buf, source.data(), int32_t(source.size()), run.start, run.length);
+		hb_buffer_set_direction(primary_instance.hb_buf, rtl ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
+		hb_buffer_set_language(primary_instance.hb_buf, state.world.locale_get_resolved_language(locale));
+		if(run.font == primary)
+			hb_buffer_set_script(primary_instance.hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
+		else
+			hb_buffer_guess_segment_properties(primary_instance.hb_buf);
+
+		hb_shape(instance.hb_font_face, primary_instance.hb_buf, features, feature_count);
+
+		uint32_t gcount = 0;
+		hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(primary_instance.hb_buf, &gcount);
+		hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(primary_instance.hb_buf, &gcount);
+		out.infos.insert(out.infos.end(), glyph_info, glyph_info + gcount);
+		out.positions.insert(out.positions.end(), glyph_pos, glyph_pos + gcount);
+		out.fonts.insert(out.fonts.end(), gcount, uint16_t(run.font == primary ? 0 : run.font + 1));
+	}
+}
+
+}
+
+void font_at_size::remake_cache(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t> source, uint32_t details_offset, layout_details* d, uint16_t font_handle) {
+	txt.clear();
+
+	if(source.size() == 0)
+		return;
+
+	auto locale = state.font_collection.get_current_locale();
+	UErrorCode errorCode = U_ZERO_ERROR;
+
+	// text without anything right to left in a left to right locale is a single left to right run
+	bool all_ltr = !state.world.locale_get_native_rtl(locale) && is_all_ltr(source);
+	std::optional<bidi_lease> bidi;
+	if(!all_ltr)
+		bidi.emplace(int32_t(source.size()));
+
+	hb_feature_t feature_buffer[10];
+	uint32_t hb_feature_count = locale_font_features(state, locale, type, feature_buffer);
+
+	if(bidi)
+		ubidi_setPara(bidi->get(), (UChar const*)(source.data()), int32_t(source.size()), state.world.locale_get_native_rtl(locale) ? 1 : 0, nullptr, &errorCode);
+
+	auto primary = state.font_collection.get_font_index(state, type);
+	fallback_shaping fallback;
 
 	if(U_SUCCESS(errorCode)) {
-		auto runcount = ubidi_countRuns(para, &errorCode);
+		auto runcount = bidi ? ubidi_countRuns(bidi->get(), &errorCode) : int32_t(1);
 		float total_x_advance = 0;
 
 		if(U_SUCCESS(errorCode)) {
@@ -542,28 +811,40 @@ void font_at_size::remake_cache(sys::state& state, font_selection type, stored_g
 			for(int32_t i = 0; i < runcount; ++i) {
 				int32_t logical_start = 0;
 				int32_t length = 0;
-				auto direction = ubidi_getVisualRun(para, i, &logical_start, &length);
-
-				// shape run with harfbuzz
-				hb_buffer_clear_contents(hb_buf);
-				hb_buffer_add_utf16(hb_buf, source.data(), int32_t(source.size()), logical_start, length);
-
-				hb_buffer_set_direction(hb_buf, direction == UBIDI_RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
-				hb_buffer_set_script(hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
-				hb_buffer_set_language(hb_buf, state.world.locale_get_resolved_language(locale));
-
-				hb_shape(hb_font_face, hb_buf, feature_buffer, hb_feature_count);
+				auto direction = UBIDI_LTR;
+				if(bidi)
+					direction = ubidi_getVisualRun(bidi->get(), i, &logical_start, &length);
+				else
+					length = int32_t(source.size());
 
 				uint32_t gcount = 0;
-				hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(hb_buf, &gcount);
-				hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(hb_buf, &gcount);
+				hb_glyph_info_t* glyph_info = nullptr;
+				hb_glyph_position_t* glyph_pos = nullptr;
+
+				bool uses_fallback = split_by_coverage(state.font_collection, primary, source, logical_start, length, fallback.runs);
+				if(uses_fallback) {
+					shape_with_fallback(state, *this, primary, source, direction == UBIDI_RTL, feature_buffer, hb_feature_count, fallback);
+					gcount = uint32_t(fallback.infos.size());
+					glyph_info = fallback.infos.data();
+					glyph_pos = fallback.positions.data();
+				} else {
+					// shape run with harfbuzz
+					hb_buffer_clear_contents(hb_buf);
+					hb_buffer_add_utf16(hb_buf, source.data(), int32_t(source.size()), logical_start, length);
+
+					hb_buffer_set_direction(hb_buf, direction == UBIDI_RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
+					hb_buffer_set_script(hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
+					hb_buffer_set_language(hb_buf, state.world.locale_get_resolved_language(locale));
+
+					hb_shape(hb_font_face, hb_buf, feature_buffer, hb_feature_count);
+
+					glyph_info = hb_buffer_get_glyph_infos(hb_buf, &gcount);
+					glyph_pos = hb_buffer_get_glyph_positions(hb_buf, &gcount);
+				}
 
 				if(d) {
-					UBreakIterator* cb_it = ubrk_openBinaryRules(state.font_collection.compiled_char_ubrk_rules.data(), int32_t(state.font_collection.compiled_char_ubrk_rules.size()), (UChar const*)(source.data() + logical_start), int32_t(length), &errorCode);
-
-					if(!cb_it || !U_SUCCESS(errorCode)) {
-						std::abort(); // couldn't create iterator
-					}
+					break_iterator_lease cb_lease(state, break_type::character, (char16_t const*)(source.data() + logical_start), int32_t(length));
+					auto cb_it = cb_lease.get();
 
 					ubrk_first(cb_it);
 					int32_t start_cluster_position = 0;
@@ -630,14 +911,10 @@ void font_at_size::remake_cache(sys::state& state, font_selection type, stored_g
 					} while(next_cluster_position != UBRK_DONE);
 
 					last_run_rightmost = previous_rightmost_in_run;
-					ubrk_close(cb_it);
 
 					// find word breaks
-					UBreakIterator* wb_it = ubrk_openBinaryRules(state.font_collection.compiled_word_ubrk_rules.data(), int32_t(state.font_collection.compiled_word_ubrk_rules.size()), (UChar const*)(source.data() + logical_start), int32_t(length), &errorCode);
-
-					if(!wb_it || !U_SUCCESS(errorCode)) {
-						std::abort(); // couldn't create iterator
-					}
+					break_iterator_lease wb_lease(state, break_type::word, (char16_t const*)(source.data() + logical_start), int32_t(length));
+					auto wb_it = wb_lease.get();
 					ubrk_first(wb_it);
 
 					int32_t start_wb_position = 0;
@@ -669,7 +946,6 @@ void font_at_size::remake_cache(sys::state& state, font_selection type, stored_g
 
 						start_wb_position = next_wb_position;
 					} while(next_wb_position != UBRK_DONE);
-					ubrk_close(wb_it);
 
 					// find visual location of graphemes
 					for(auto k = start_of_new_entries; k < d->grapheme_placement.size(); ++k) {
@@ -742,7 +1018,7 @@ void font_at_size::remake_cache(sys::state& state, font_selection type, stored_g
 				for(unsigned int j = 0; j < gcount; j++) { // Preload glyphs
 					total_x_advance += glyph_pos[j].x_advance / (text::fixed_to_fp * state.user_settings.ui_scale);
 					//make_glyph(uint16_t(glyph_info[j].codepoint));
-					txt.glyph_info.emplace_back(glyph_info[j], glyph_pos[j]);
+					txt.glyph_info.emplace_back(glyph_info[j], glyph_pos[j], uses_fallback ? fallback.fonts[j] : uint16_t(0));
 				}
 			}
 		} else {
@@ -753,12 +1029,10 @@ void font_at_size::remake_cache(sys::state& state, font_selection type, stored_g
 		// failure to add text
 		std::abort();
 	}
-
-	ubidi_close(para);
 }
 
 void font_at_size::remake_bidiless_cache(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t> source) {
-	txt.glyph_info.clear();
+	txt.clear();
 	if(source.size() == 0)
 		return;
 
@@ -766,32 +1040,33 @@ void font_at_size::remake_bidiless_cache(sys::state& state, font_selection type,
 	auto locale = state.font_collection.get_current_locale();
 	
 	hb_feature_t feature_buffer[10];
-	auto features = type == font_selection::body_font ? state.world.locale_get_body_font_features(locale) : state.world.locale_get_header_font_features(locale);
-	for(uint32_t i = 0; i < uint32_t(std::extent_v<decltype(feature_buffer)>) && i < features.size(); ++i) {
-		feature_buffer[i].tag = features[i];
-		feature_buffer[i].start = 0;
-		feature_buffer[i].end = (unsigned int)-1;
-		feature_buffer[i].value = 1;
-	}
-	uint32_t hb_feature_count = std::min(features.size(), uint32_t(std::extent_v<decltype(feature_buffer)>));
-
-	// shape run with harfbuzz
-	hb_buffer_clear_contents(hb_buf);
-	hb_buffer_add_utf16(hb_buf, source.data(), int32_t(source.size()), 0, int32_t(source.size()));
+	uint32_t hb_feature_count = locale_font_features(state, locale, type, feature_buffer);
+
+	auto primary = state.font_collection.get_font_index(state, type);
+	fallback_shaping fallback;
+	if(split_by_coverage(state.font_collection, primary, source, 0, int32_t(source.size()), fallback.runs)) {
+		shape_with_fallback(state, *this, primary, source, state.world.locale_get_native_rtl(locale), feature_buffer, hb_feature_count, fallback);
+		for(size_t j = 0; j < fallback.infos.size(); j++)
+			txt.glyph_info.emplace_back(fallback.infos[j], fallback.positions[j], fallback.fonts[j]);
+	} else {
+		// shape run with harfbuzz
+		hb_buffer_clear_contents(hb_buf);
+		hb_buffer_add_utf16(hb_buf, source.data(), int32_t(source.size()), 0, int32_t(source.size()));
 
-	hb_buffer_set_direction(hb_buf, state.world.locale_get_native_rtl(locale) ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
-	hb_buffer_set_script(hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
-	hb_buffer_set_language(hb_buf, state.world.locale_get_resolved_language(locale));
+		hb_buffer_set_direction(hb_buf, state.world.locale_get_native_rtl(locale) ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
+		hb_buffer_set_script(hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
+		hb_buffer_set_language(hb_buf, state.world.locale_get_resolved_language(locale));
 
-	hb_shape(hb_font_face, hb_buf, feature_buffer, hb_feature_count);
+		hb_shape(hb_font_face, hb_buf, feature_buffer, hb_feature_count);
 
-	uint32_t gcount = 0;
-	hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(hb_buf, &gcount);
-	hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(hb_buf, &gcount);
+		uint32_t gcount = 0;
+		hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(hb_buf, &gcount);
+		hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(hb_buf, &gcount);
 
-	for(unsigned int j = 0; j < gcount; j++) { // Preload glyphs
-		//make_glyph(uint16_t(glyph_info[j].codepoint));
-		txt.glyph_info.emplace_back(glyph_info[j], glyph_pos[j]);
+		for(unsigned int j = 0; j < gcount; j++) { // Preload glyphs
+			//make_glyph(uint16_t(glyph_info[j].codepoint));
+			txt.glyph_info.emplace_back(glyph_info[j], glyph_pos[j]);
+		}
 	}
 
 	if(state.world.locale_get_native_rtl(locale)) {
@@ -800,7 +1075,188 @@ void font_at_size::remake_bidiless_cache(sys::state& state, font_selection type,
 }
 
 
+namespace {
+
+// everything the number formatters write, including the separators of every locale
+constexpr std::u16string_view numeric_characters = u"0123456789.,-+%<>/ KMBTPZ\u00A3\u00A0\u2019\u202F'";
+
+}
+
+bool font_at_size::shape_numeric(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t const> source) {
+	auto locale = state.font_collection.get_current_locale();
+	if(source.empty() || state.world.locale_get_native_rtl(locale))
+		return false;
+	// the set also holds the unit letters, so text such as "MB" has to be kept out by requiring a digit
+	bool has_digit = false;
+	for(auto c : source) {
+		if(u'0' <= c && c <= u'9') {
+			has_digit = true;
+			break;
+		}
+	}
+	if(!has_digit)
+		return false;
+
+	auto& table = numeric_glyphs[size_t(type)];
+	if(numeric_glyphs_locale[size_t(type)] != locale || table.empty()) {
+		hb_feature_t feature_buffer[10];
+		uint32_t hb_feature_count = locale_font_features(state, locale, type, feature_buffer);
+
+		table.assign(numeric_characters.size(), stored_glyph{ });
+		for(size_t i = 0; i < numeric_characters.size(); ++i) {
+			hb_buffer_clear_contents(hb_buf);
+			hb_buffer_add_utf16(hb_buf, (uint16_t const*)(numeric_characters.data() + i), 1, 0, 1);
+			hb_buffer_set_direction(hb_buf, HB_DIRECTION_LTR);
+			hb_buffer_set_script(hb_buf, (hb_script_t)state.world.locale_get_hb_script(locale));
+			hb_buffer_set_language(hb_buf, state.world.locale_get_resolved_language(locale));
+			hb_shape(hb_font_face, hb_buf, feature_buffer, hb_feature_count);
+
+			uint32_t gcount = 0;
+			hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(hb_buf, &gcount);
+			hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(hb_buf, &gcount);
+			if(gcount == 1 && glyph_info[0].codepoint != 0)
+				table[i] = stored_glyph(glyph_info[0], glyph_pos[0]);
+		}
+		numeric_glyphs_locale[size_t(type)] = locale;
+	}
+
+	txt.clear();
+	for(size_t i = 0; i < source.size(); ++i) {
+		auto pos = numeric_characters.find(char16_t(source[i]));
+		if(pos == std::u16string_view::npos || table[pos].codepoint == 0) {
+			txt.clear();
+			return false;
+		}
+		txt.glyph_info.push_back(table[pos]);
+		txt.glyph_info.back().cluster = uint32_t(i);
+	}
+	return true;
+}
+
+void stored_glyphs::build_advance_index() {
+	advance_prefix.resize(glyph_info.size() + 1);
+	int64_t total = 0;
+	advance_prefix[0] = 0;
+	for(size_t i = 0; i < glyph_info.size(); ++i) {
+		total += glyph_info[i].x_advance;
+		advance_prefix[i + 1] = total;
+	}
+}
+
+void layout_details::build_index() {
+	line_starts.clear();
+	line_sorted.clear();
+
+	offsets_sorted = true;
+	for(size_t i = 1; i < grapheme_placement.size(); ++i) {
+		if(grapheme_placement[i].source_offset < grapheme_placement[i - 1].source_offset) {
+			offsets_sorted = false;
+			break;
+		}
+	}
+
+	// each line has to be one contiguous run of clusters for the per line lookups to work
+	for(size_t i = 0; i < grapheme_placement.size(); ++i) {
+		auto line = grapheme_placement[i].line;
+		if(line < line_starts.size()) {
+			if(line != line_starts.size() - 1) {
+				line_starts.clear();
+				line_sorted.clear();
+				return;
+			}
+		} else {
+			while(line_starts.size() <= line) {
+				line_starts.push_back(uint32_t(i));
+				line_sorted.push_back(1);
+			}
+		}
+		auto& gi = grapheme_placement[i];
+		if((gi.flags & ex_grapheme_cluster_info::f_has_rtl_directionality) != 0 || gi.width < 0) {
+			line_sorted[line] = 0;
+		} else if(line_starts[line] != i) {
+			auto& prev = grapheme_placement[i - 1];
+			if(gi.x_offset < prev.x_offset || gi.x_offset + gi.width < prev.x_offset + prev.width)
+				line_sorted[line] = 0;
+		}
+	}
+	line_starts.push_back(uint32_t(grapheme_placement.size()));
+}
+
+grapheme_hit layout_details::hit_test_line(int32_t line, int32_t xpos) const {
+	size_t first = 0;
+	size_t last = grapheme_placement.size();
+	bool sorted = false;
+	if(!line_starts.empty()) {
+		if(line < 0 || size_t(line) + 1 >= line_starts.size())
+			return grapheme_hit{ };
+		first = line_starts[line];
+		last = line_starts[line + 1];
+		sorted = line_sorted[line] != 0;
+	}
+
+	if(sorted && first != last) {
+		// the last cluster starting at or before xpos is the only one that can contain it
+		auto it = std::upper_bound(grapheme_placement.begin() + first, grapheme_placement.begin() + last, xpos, [](int32_t x, ex_grapheme_cluster_info const& gi) { return x < gi.x_offset; });
+		auto k = int32_t(it - grapheme_placement.begin()) - 1;
+		if(k >= int32_t(first) && xpos <= grapheme_placement[k].x_offset + grapheme_placement[k].width)
+			return grapheme_hit{ k, grapheme_hit::position::inside };
+
+		grapheme_hit result;
+		int32_t distance_from_fit = 0;
+		if(size_t(k + 1) < last) {
+			// among clusters sharing the nearest left edge, the scan below would keep the last one
+			auto x = grapheme_placement[k + 1].x_offset;
+			auto j = k + 1;
+			while(size_t(j + 1) < last && grapheme_placement[j + 1].x_offset == x)
+				++j;
+			result = grapheme_hit{ j, grapheme_hit::position::before };
+			distance_from_fit = x - xpos;
+		}
+		if(k >= int32_t(first)) {
+			auto d = (xpos + 1) - (grapheme_placement[k].x_offset + grapheme_placement[k].width);
+			if(result.index == -1 || d < distance_from_fit)
+				result = grapheme_hit{ k, grapheme_hit::position::after };
+		}
+		return result;
+	}
+
+	grapheme_hit result;
+	int32_t distance_from_fit = 0;
+	for(size_t i = last; i-- > first; ) {
+		auto& gi = grapheme_placement[i];
+		if(gi.line == line) {
+			if(gi.x_offset <= xpos && xpos <= gi.x_offset + gi.width)
+				return grapheme_hit{ int32_t(i), grapheme_hit::position::inside };
+			if(xpos < gi.x_offset) {
+				if(result.index == -1 || (gi.x_offset - xpos) < distance_from_fit) {
+					result = grapheme_hit{ int32_t(i), grapheme_hit::position::before };
+					distance_from_fit = int32_t(gi.x_offset - xpos);
+				}
+			}
+			if(xpos >= gi.x_offset + gi.width) {
+				if(result.index == -1 || ((xpos + 1) - (gi.x_offset + gi.width)) < distance_from_fit) {
+					result = grapheme_hit{ int32_t(i), grapheme_hit::position::after };
+					distance_from_fit = int32_t((xpos + 1) - (gi.x_offset + gi.width));
+				}
+			}
+		}
+	}
+	return result;
+}
+
+std::pair<size_t, size_t> layout_details::clusters_for_source_range(int32_t start, int32_t end) const {
+	if(!offsets_sorted)
+		return std::pair<size_t, size_t>{ 0, grapheme_placement.size() };
+	auto b = std::lower_bound(grapheme_placement.begin(), grapheme_placement.end(), start, [](ex_grapheme_cluster_info const& gi, int32_t v) { return int32_t(gi.source_offset) < v; });
+	auto e = std::upper_bound(b, grapheme_placement.end(), end, [](int32_t v, ex_grapheme_cluster_info const& gi) { return v < int32_t(gi.source_offset); });
+	return std::pair<size_t, size_t>{ size_t(b - grapheme_placement.begin()), size_t(e - grapheme_placement.begin()) };
+}
+
 float font_at_size::text_extent(sys::state& state, stored_glyphs const& txt, uint32_t starting_offset, uint32_t count) {
+	if(txt.has_advance_index()) {
+		auto total = txt.advance_prefix[starting_offset + count] - txt.advance_prefix[starting_offset];
+		return (float(total) / text::fixed_to_fp) / state.user_settings.ui_scale;
+	}
 	float x_total = 0.0f;
 	for(uint32_t i = starting_offset; i < starting_offset + count; i++) {
 		hb_codepoint_t glyphid = txt.glyph_info[i].codepoint;
@@ -830,6 +1286,108 @@ float font_at_size::stateless_text_extent(float ui_scale, char const* codepoints
 	return x / ui_scale;
 }
 
+void shaping_batch::queue(sys::state& state, std::string_view text, uint16_t font_id) {
+	std::u16string temp_text;
+	auto start = text.data();
+	auto end = start + text.length();
+	for(auto pos = start; pos < end; pos += size_from_utf8(pos, end)) {
+		// the same escapes that add_unparsed_text_to_layout_box splits the text on
+		if(*pos == '$' || *pos == '@' || *pos == '?' || uint8_t(*pos) == 0xC2 || uint8_t(*pos) == 0xEF)
+			return;
+		auto c = codepoint_from_utf8(pos, end);
+		if(!requires_surrogate_pair(c)) {
+			temp_text.push_back(char16_t(c));
+		} else {
+			auto p = make_surrogate_pair(c);
+			temp_text.push_back(char16_t(p.high));
+			temp_text.push_back(char16_t(p.low));
+		}
+	}
+	queue(state, temp_text, font_index_from_font_id(state, font_id), size_from_font_id(font_id));
+}
+
+void shaping_batch::queue(sys::state& state, std::u16string_view text, font_selection type, int32_t size) {
+	if(text.empty())
+		return;
+	auto pixel_size = int32_t(size * state.user_settings.ui_scale);
+	if(index.contains(lookup{ text, type, pixel_size }))
+		return;
+	requests.push_back(request{ std::u16string(text), type, pixel_size });
+	index.insert(uint32_t(requests.size() - 1));
+}
+
+stored_glyphs const* shaping_batch::find(font_selection type, int32_t pixel_size, std::span<uint16_t const> text, bool bidi) const {
+	auto it = index.find(lookup{ std::u16string_view((char16_t const*)text.data(), text.size()), type, pixel_size });
+	if(it == index.end() || !requests[*it].shaped)
+		return nullptr;
+	return bidi ? &requests[*it].glyphs : &requests[*it].bidiless_glyphs;
+}
+
+void shaping_batch::shape_all(sys::state& state) {
+	auto& fm = state.font_collection;
+
+	// text that needs glyphs from a fallback font touches the shared font instances, so it is left for the ui thread
+	std::vector<uint32_t> order;
+	order.reserve(requests.size());
+	std::vector<font_run> runs;
+	for(uint32_t i = 0; i < uint32_t(requests.size()); ++i) {
+		auto& r = requests[i];
+		if(!split_by_coverage(fm, fm.get_font_index(state, r.type), std::span<uint16_t>((uint16_t*)r.text.data(), r.text.size()), 0, int32_t(r.text.size()), runs))
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return std::pair(requests[a].type, requests[a].pixel_size) < std::pair(requests[b].type, requests[b].pixel_size);
+	});
+
+	// each slice gets its own face, harfbuzz font and buffer; freetype faces may only be created and destroyed
+	// one at a time, so that happens here rather than on the workers
+	struct slice {
+		uint32_t start = 0;
+		uint32_t end = 0;
+		font_selection type = font_selection::body_font;
+		int32_t pixel_size = 0;
+		font_at_size instance;
+	};
+	std::vector<slice> slices;
+	constexpr uint32_t min_slice_size = 16;
+	auto max_slices = std::max(uint32_t(std::thread::hardware_concurrency()), uint32_t(1)) * 2;
+	for(uint32_t group_start = 0; group_start < uint32_t(order.size()); ) {
+		auto& first = requests[order[group_start]];
+		auto group_end = group_start + 1;
+		while(group_end < uint32_t(order.size()) && requests[order[group_end]].type == first.type && requests[order[group_end]].pixel_size == first.pixel_size)
+			++group_end;
+
+		auto count = group_end - group_start;
+		auto slice_count = std::clamp(count / min_slice_size, uint32_t(1), max_slices);
+		for(uint32_t j = 0; j < slice_count; ++j) {
+			auto& s = slices.emplace_back();
+			s.start = group_start + count * j / slice_count;
+			s.end = group_start + count * (j + 1) / slice_count;
+			s.type = first.type;
+			s.pixel_size = first.pixel_size;
+		}
+		group_start = group_end;
+	}
+	for(auto& s : slices) {
+		auto& f = fm.get_font(state, s.type);
+		s.instance.create(fm.ft_library, f.file_data.get(), f.file_size, s.pixel_size);
+	}
+
+	concurrency::parallel_for(size_t(0), slices.size(), [&](size_t i) {
+		auto& s = slices[i];
+		for(auto j = s.start; j < s.end; ++j) {
+			auto& r = requests[order[j]];
+			auto source = std::span<uint16_t>((uint16_t*)r.text.data(), r.text.size());
+			s.instance.remake_cache(state, r.type, r.glyphs, source);
+			s.instance.remake_bidiless_cache(state, r.type, r.bidiless_glyphs, source);
+			r.shaped = true;
+		}
+	});
+
+	for(auto& s : slices)
+		s.instance.reset();
+}
+
 uint16_t make_font_id(sys::state& state, bool as_header, float target_line_size) {
 	int32_t calculated_size = int32_t(target_line_size);
 	if(as_header) {
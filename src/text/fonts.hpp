@@ -5,8 +5,15 @@
 #include "unordered_dense.h"
 #include "hb.h"
 #include <span>
+#include <array>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 #include "graphics/opengl_wrapper.hpp"
 
+struct UBreakIterator;
+struct UBiDi;
+
 namespace sys {
 struct state;
 }
@@ -94,38 +101,98 @@ struct stored_glyph {
 	hb_position_t  y_advance = 0;
 	hb_position_t  x_offset = 0;
 	hb_position_t  y_offset = 0;
+	uint16_t fallback = 0; // 0 if the glyph belongs to the requested font, otherwise one past the index of the fallback font it came from
 
 	stored_glyph() noexcept = default;
-	stored_glyph(hb_glyph_info_t const& gi, hb_glyph_position_t const& gp) {
+	stored_glyph(hb_glyph_info_t const& gi, hb_glyph_position_t const& gp, uint16_t fallback = 0) {
 		codepoint = gi.codepoint;
 		cluster = gi.cluster;
 		x_advance = gp.x_advance;
 		y_advance = gp.y_advance;
 		x_offset = gp.x_offset;
 		y_offset = gp.y_offset;
+		stored_glyph::fallback = fallback;
+	}
+};
+
+// which codepoints a font has glyphs for, as one bit per codepoint in pages of 256 codepoints.
+// pages without any glyphs all share the empty page 0
+class font_coverage {
+	std::vector<uint16_t> page_index;
+	std::vector<std::array<uint64_t, 4>> pages;
+public:
+	static constexpr char32_t codepoint_limit = 0x110000;
+
+	void build(FT_Face face);
+	bool empty() const {
+		return page_index.empty();
 	}
+	bool covers(char32_t c) const {
+		if(c >= codepoint_limit || page_index.empty())
+			return false;
+		auto& p = pages[page_index[c >> 8]];
+		return ((p[(c >> 6) & 3] >> (c & 63)) & 1) != 0;
+	}
+};
+
+struct grapheme_hit {
+	enum class position : uint8_t { none, inside, before, after };
+	int32_t index = -1; // the grapheme cluster that was hit, or the nearest one on the line
+	position type = position::none; // before / after: the point lies left / right of the cluster
 };
 
 struct layout_details {
 	std::vector<ex_grapheme_cluster_info> grapheme_placement;
+	// built by build_index once the layout is complete
+	std::vector<uint32_t> line_starts; // first cluster of each line followed by the cluster count; empty if lines are not contiguous
+	std::vector<uint8_t> line_sorted; // 1 where a line is all left to right with non decreasing cluster edges
+	bool offsets_sorted = false; // source offsets increase with the cluster index
 	uint8_t total_lines = 0;
+
+	void clear() {
+		grapheme_placement.clear();
+		line_starts.clear();
+		line_sorted.clear();
+		offsets_sorted = false;
+		total_lines = 0;
+	}
+	void build_index();
+	// the cluster under or nearest to xpos on the line, preferring the highest index on ties
+	grapheme_hit hit_test_line(int32_t line, int32_t xpos) const;
+	// the range of clusters whose source offsets fall into [start, end]
+	std::pair<size_t, size_t> clusters_for_source_range(int32_t start, int32_t end) const;
 };
 
 struct stored_glyphs {
-	std::vector<stored_glyph> glyph_info;
+	// copies always go back to the default heap; moves keep the memory the glyphs were shaped into
+	std::pmr::vector<stored_glyph> glyph_info;
+	// optional running total of x_advance: advance_prefix[i] is the advance of the first i glyphs
+	std::pmr::vector<int64_t> advance_prefix;
 
 	struct no_bidi { };
 
 	stored_glyphs() = default;
+	explicit stored_glyphs(std::pmr::memory_resource* memory) : glyph_info(memory), advance_prefix(memory) { }
 	stored_glyphs(stored_glyphs const& other) noexcept = default;
 	stored_glyphs(stored_glyphs&& other) noexcept = default;
+	stored_glyphs& operator=(stored_glyphs const& other) = default;
+	stored_glyphs& operator=(stored_glyphs&& other) = default;
 	stored_glyphs(stored_glyphs& other, uint32_t offset, uint32_t count);
 	stored_glyphs(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, uint32_t details_offset = 0, layout_details* d = nullptr, uint16_t font_handle = 0);
 	stored_glyphs(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, no_bidi);
 
+	// shape into the existing storage, keeping its memory resource
+	void shape(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, uint32_t details_offset = 0, layout_details* d = nullptr, uint16_t font_handle = 0);
+	void shape(sys::state& state, int32_t size, font_selection type, std::span<uint16_t> s, no_bidi);
+
 	//void set_text(sys::state& state, font_selection type, std::string const& s);
+	void build_advance_index();
+	bool has_advance_index() const {
+		return advance_prefix.size() == glyph_info.size() + 1;
+	}
 	void clear() {
 		glyph_info.clear();
+		advance_prefix.clear();
 	}
 };
 
@@ -141,6 +208,10 @@ private:
 	uint32_t internal_tx_line_ypos = 1024;
 	int32_t px_size = 0;
 	ankerl::unordered_dense::map<uint32_t, glyph_sub_offset> glyph_positions;
+	// the characters numbers are formatted with, shaped one at a time per font selection so that numbers can be
+	// laid out without going through harfbuzz; a glyph of 0 marks a character the font has to shape normally
+	std::vector<stored_glyph> numeric_glyphs[2];
+	dcon::locale_id numeric_glyphs_locale[2];
 public:
 	FT_Face font_face = nullptr;
 	hb_font_t* hb_font_face = nullptr;
@@ -155,12 +226,17 @@ public:
 	void create(FT_Library lib, FT_Byte* file_data, size_t file_size, int32_t real_size);
 	void remake_cache(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t> source, uint32_t details_offset = 0, layout_details* d = nullptr, uint16_t font_handle = 0);
 	void remake_bidiless_cache(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t> source);
+	// fills txt and returns true when the text is made only of numeric characters; left to right locales only
+	bool shape_numeric(sys::state& state, font_selection type, stored_glyphs& txt, std::span<uint16_t const> source);
 	float line_height(sys::state& state) const;
 	float ascender(sys::state& state) const;
 	float descender(sys::state& state) const;
 	float top_adjustment(sys::state& state) const;
 	float text_extent(sys::state& state, stored_glyphs const& txt, uint32_t starting_offset, uint32_t count);
 	float stateless_text_extent(float ui_scale, char const* codepoints, uint32_t count);
+	int32_t pixel_size() const {
+		return px_size;
+	}
 
 	font_at_size() = default;
 	font_at_size(font_at_size&& o) noexcept : glyph_positions(std::move(o.glyph_positions)), textures(o.textures) {
@@ -177,6 +253,11 @@ public:
 		internal_tx_line_height = o.internal_tx_line_height;
 		internal_tx_line_xpos = o.internal_tx_line_xpos;
 		internal_tx_line_ypos = o.internal_tx_line_ypos;
+		px_size = o.px_size;
+		for(size_t i = 0; i < 2; ++i) {
+			numeric_glyphs[i] = std::move(o.numeric_glyphs[i]);
+			numeric_glyphs_locale[i] = o.numeric_glyphs_locale[i];
+		}
 	}
 	font_at_size& operator=(font_at_size&& o) noexcept {
 		glyph_positions = std::move(o.glyph_positions);
@@ -194,6 +275,11 @@ public:
 		internal_tx_line_height = o.internal_tx_line_height;
 		internal_tx_line_xpos = o.internal_tx_line_xpos;
 		internal_tx_line_ypos = o.internal_tx_line_ypos;
+		px_size = o.px_size;
+		for(size_t i = 0; i < 2; ++i) {
+			numeric_glyphs[i] = std::move(o.numeric_glyphs[i]);
+			numeric_glyphs_locale[i] = o.numeric_glyphs_locale[i];
+		}
 		return *this;
 	}
 };
@@ -210,6 +296,7 @@ public:
 
 	std::unique_ptr<FT_Byte[]> file_data;
 	size_t file_size = 0;
+	font_coverage coverage;
 
 	~font();
 
@@ -220,18 +307,124 @@ public:
 
 	friend class font_manager;
 
-	font(font&& o) noexcept : file_name(std::move(o.file_name)),  file_data(std::move(o.file_data)) {
+	font(font&& o) noexcept : file_name(std::move(o.file_name)),  file_data(std::move(o.file_data)), coverage(std::move(o.coverage)) {
 		file_size = o.file_size;
 	}
 	font& operator=(font&& o) noexcept {
 		file_name = std::move(o.file_name);
 		file_data = std::move(o.file_data);
+		coverage = std::move(o.coverage);
 		file_size = o.file_size;
 		o.file_size = 0;
 		return *this;
 	}
 };
 
+enum class break_type : uint8_t { line, character, word };
+constexpr size_t break_type_count = 3;
+
+// a break iterator borrowed from the calling thread's pool and pointed at the text; it is built from the locale's
+// compiled rules the first time and then only reset with ubrk_setText
+class break_iterator_lease {
+	UBreakIterator* it = nullptr;
+	break_type type = break_type::line;
+	uint32_t rules_generation = 0;
+public:
+	break_iterator_lease(sys::state& state, break_type type, char16_t const* text, int32_t length);
+	~break_iterator_lease();
+	break_iterator_lease(break_iterator_lease const&) = delete;
+	break_iterator_lease& operator=(break_iterator_lease const&) = delete;
+	UBreakIterator* get() const {
+		return it;
+	}
+};
+
+// a bidi object borrowed from the calling thread's pool, sized for at least the given length
+class bidi_lease {
+	UBiDi* para = nullptr;
+	int32_t capacity = 0;
+public:
+	explicit bidi_lease(int32_t length);
+	~bidi_lease();
+	bidi_lease(bidi_lease const&) = delete;
+	bidi_lease& operator=(bidi_lease const&) = delete;
+	UBiDi* get() const {
+		return para;
+	}
+};
+
+// true when no character in the text can start a right to left run, so that a left to right paragraph is one run
+bool is_all_ltr(std::span<uint16_t const> text);
+
+// text that is about to be laid out again (after a change of ui scale, for example), gathered so that it can be
+// shaped in parallel up front. while the batch is installed as the font manager's prepared_shapes, stored_glyphs::shape
+// copies matching results out of it instead of shaping on the calling thread
+class shaping_batch {
+	struct request {
+		std::u16string text;
+		font_selection type = font_selection::body_font;
+		int32_t pixel_size = 0;
+		bool shaped = false;
+		stored_glyphs glyphs;
+		stored_glyphs bidiless_glyphs;
+	};
+	struct lookup {
+		std::u16string_view text;
+		font_selection type = font_selection::body_font;
+		int32_t pixel_size = 0;
+	};
+	struct request_hash {
+		using is_avalanching = void;
+		using is_transparent = void;
+
+		std::vector<request>& requests;
+
+		auto operator()(lookup const& l) const noexcept -> uint64_t {
+			return ankerl::unordered_dense::hash<std::u16string_view>{}(l.text) ^ ((uint64_t(l.pixel_size) << 1 | uint64_t(l.type)) * 0x9E3779B97F4A7C15ull);
+		}
+		auto operator()(uint32_t i) const noexcept -> uint64_t {
+			return (*this)(lookup{ requests[i].text, requests[i].type, requests[i].pixel_size });
+		}
+	};
+	struct request_eq {
+		using is_transparent = void;
+
+		std::vector<request>& requests;
+
+		bool operator()(uint32_t l, uint32_t r) const noexcept {
+			return l == r;
+		}
+		bool operator()(lookup const& l, uint32_t r) const noexcept {
+			return l.type == requests[r].type && l.pixel_size == requests[r].pixel_size && l.text == requests[r].text;
+		}
+		bool operator()(uint32_t r, lookup const& l) const noexcept {
+			return (*this)(l, r);
+		}
+	};
+
+	std::vector<request> requests;
+	ankerl::unordered_dense::set<uint32_t, request_hash, request_eq> index;
+public:
+	shaping_batch() : index(0, request_hash{ requests }, request_eq{ requests }) { }
+	shaping_batch(shaping_batch const&) = delete;
+	shaping_batch& operator=(shaping_batch const&) = delete;
+
+	// plain utf8 text for a font id; text with color codes, icons or variables is left to be shaped when laid out
+	void queue(sys::state& state, std::string_view text, uint16_t font_id);
+	void queue(sys::state& state, std::u16string_view text, font_selection type, int32_t size);
+	void shape_all(sys::state& state);
+	stored_glyphs const* find(font_selection type, int32_t pixel_size, std::span<uint16_t const> text, bool bidi) const;
+	size_t size() const {
+		return requests.size();
+	}
+};
+
+// the separators numbers are written with in the current locale
+struct number_format {
+	char16_t decimal_point = u'.';
+	char16_t group_separator = u',';
+};
+
 class font_manager {
 public:
 	font_manager();
@@ -239,13 +432,21 @@ public:
 
 	ankerl::unordered_dense::map<uint16_t, dcon::text_key> font_names;
 	FT_Library ft_library;
+	static constexpr uint16_t no_font = 0xFFFF;
 private:
 	std::vector<font> font_array;
+	ankerl::unordered_dense::map<std::string, uint16_t> font_indices; // file name to position in font_array
+	std::vector<uint16_t> fallback_chain; // fonts of the other locales, tried in order for codepoints the locale's own fonts lack
 	dcon::locale_id current_locale;
+
+	uint16_t find_or_load_font(sys::state& state, std::string const& fname, bool required);
 public:
 	std::vector<uint8_t> compiled_ubrk_rules;
 	std::vector<uint8_t> compiled_char_ubrk_rules;
 	std::vector<uint8_t> compiled_word_ubrk_rules;
+	uint32_t break_rules_generation = 0; // changes whenever the compiled rules do, so that pooled iterators are rebuilt
+	shaping_batch const* prepared_shapes = nullptr;
+	number_format numbers;
 	bool map_font_is_black = false;
 
 	dcon::locale_id get_current_locale() const {
@@ -254,6 +455,12 @@ public:
 	void change_locale(sys::state& state, dcon::locale_id l);
 	void reset_fonts();
 	font& get_font(sys::state& state, font_selection s = font_selection::body_font);
+	uint16_t get_font_index(sys::state& state, font_selection s = font_selection::body_font);
+	font& get_font_by_index(uint16_t index) {
+		return font_array[index];
+	}
+	// the font that should display the codepoint: primary if it can, otherwise the first font in the fallback chain that can
+	uint16_t font_for_codepoint(uint16_t primary, char32_t c) const;
 	void load_font(font& fnt, char const* file_data, uint32_t file_size);
 	float line_height(sys::state& state, uint16_t font_id);
 	float text_extent(sys::state& state, stored_glyphs const& txt, uint32_t starting_offset, uint32_t count, uint16_t font_id);
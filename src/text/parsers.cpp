@@ -1,6 +1,9 @@
 #include "parsers.hpp"
 #include <charconv>
 #include <algorithm>
+#include <bit>
+#include <cstring>
+#include <immintrin.h>
 
 namespace parsers {
 bool ignorable_char(char c) {
@@ -116,11 +119,98 @@ char const* advance_position_to_breaking_char(char const* start, char const* end
 	return scan_for_match(start, end, current_line, breaking_char);
 }
 
+void classify_block(classified_block& blk, char const* base, char const* file_end) {
+	blk.base = base;
+
+	alignas(32) char padded[64];
+	char const* p = base;
+	if(file_end - base < 64) {
+		std::memset(padded, 0, 64);
+		std::memcpy(padded, base, size_t(file_end - base));
+		p = padded;
+	}
+
+#if defined(__AVX2__)
+	auto const lo = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+	auto const hi = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 32));
+	auto eq = [&](char c) {
+		auto const v = _mm256_set1_epi8(c);
+		return uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v))))
+			| (uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)))) << 32);
+	};
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	__m128i const q[4] = {
+		_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)),
+		_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16)),
+		_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 32)),
+		_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 48))
+	};
+	auto eq = [&](char c) {
+		auto const v = _mm_set1_epi8(c);
+		uint64_t r = 0;
+		for(uint32_t i = 0; i < 4; ++i)
+			r |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(q[i], v)))) << (16 * i);
+		return r;
+	};
+#else
+	auto eq = [&](char c) {
+		uint64_t r = 0;
+		for(uint32_t i = 0; i < 64; ++i)
+			r |= uint64_t(p[i] == c) << i;
+		return r;
+	};
+#endif
+
+	auto const nl = eq('\n');
+	auto const cr = eq('\r');
+	auto const ws = eq(' ') | cr | eq('\f') | nl | eq('\t') | eq(',') | eq(';');
+	auto const special = eq('!') | eq('=') | eq('<') | eq('>');
+
+	blk.whitespace = ws;
+	blk.breaking = ws | eq('{') | eq('}') | special | eq('#');
+	blk.newline = nl;
+	blk.line_end = cr | nl;
+	blk.double_quote_end = eq('\"') | cr | nl;
+	blk.single_quote_end = eq('\'') | cr | nl;
+}
+
+// bitmask equivalents of scan_for_match / scan_for_not_match: jumps directly to the next byte (not) in the
+// class, counting the newlines skipped over along the way
+template<bool match>
+char const* scan_classified(classified_block& blk, uint64_t classified_block::* mask, char const* file_start, char const* start, char const* end, int32_t& current_line) {
+	while(start < end) {
+		auto const base = file_start + ((start - file_start) & ~ptrdiff_t(63));
+		if(blk.base != base)
+			classify_block(blk, base, end);
+
+		auto const offset = uint32_t(start - base);
+		auto const from_offset = ~uint64_t(0) << offset;
+		auto bits = (match ? blk.*mask : ~(blk.*mask)) & from_offset;
+		if(end - base < 64)
+			bits &= (uint64_t(1) << (end - base)) - 1;
+
+		if(bits != 0) {
+			auto const found = uint32_t(std::countr_zero(bits));
+			auto const skipped = from_offset & ~(~uint64_t(0) << found);
+			current_line += std::popcount(blk.newline & skipped);
+			return base + found;
+		}
+		current_line += std::popcount(blk.newline & from_offset);
+		start = base + 64;
+	}
+	return end;
+}
+
 token_and_type token_generator::internal_next() {
 	if(position >= file_end)
 		return token_and_type{std::string_view(), current_line, token_type::unknown};
 
-	auto non_ws = advance_position_to_non_comment(position, file_end, current_line);
+	auto non_ws = scan_classified<false>(block, &classified_block::whitespace, file_start, position, file_end, current_line);
+	while(non_ws < file_end && *non_ws == '#') {
+		// line terminators are whitespace, so skipping whitespace from the end of the comment also skips them
+		auto const line_end = scan_classified<true>(block, &classified_block::line_end, file_start, non_ws, file_end, current_line);
+		non_ws = scan_classified<false>(block, &classified_block::whitespace, file_start, line_end, file_end, current_line);
+	}
 	if(non_ws < file_end) {
 		if(*non_ws == '{') {
 			position = non_ws + 1;
@@ -129,11 +219,11 @@ token_and_type token_generator::internal_next() {
 			position = non_ws + 1;
 			return token_and_type{std::string_view(non_ws, 1), current_line, token_type::close_brace};
 		} else if(*non_ws == '\"') {
-			auto const close = scan_for_match(non_ws + 1, file_end, current_line, double_quote_termination);
+			auto const close = scan_classified<true>(block, &classified_block::double_quote_end, file_start, non_ws + 1, file_end, current_line);
 			position = close + 1;
 			return token_and_type{std::string_view(non_ws + 1, close - (non_ws + 1)), current_line, token_type::quoted_string};
 		} else if(*non_ws == '\'') {
-			auto const close = scan_for_match(non_ws + 1, file_end, current_line, single_quote_termination);
+			auto const close = scan_classified<true>(block, &classified_block::single_quote_end, file_start, non_ws + 1, file_end, current_line);
 			position = close + 1;
 			return token_and_type{std::string_view(non_ws + 1, close - (non_ws + 1)), current_line, token_type::quoted_string};
 		} else if(has_fixed_prefix(non_ws, file_end, "==") || has_fixed_prefix(non_ws, file_end, "<=") ||
@@ -147,7 +237,7 @@ token_and_type token_generator::internal_next() {
 			position = non_ws + 1;
 			return token_and_type{std::string_view(non_ws, 1), current_line, token_type::special_identifier};
 		} else {
-			position = advance_position_to_breaking_char(non_ws + 1, file_end, current_line);
+			position = scan_classified<true>(block, &classified_block::breaking, file_start, non_ws + 1, file_end, current_line);
 			return token_and_type{std::string_view(non_ws, position - non_ws), current_line, token_type::identifier};
 		}
 	} else {
@@ -269,27 +359,56 @@ association_type parse_association_type(std::string_view content, int32_t line,
 }
 
 
-separator_scan_result csv_find_separator_token(char const* start, char const* end, char seperator) {
+// returns the first position in [start, end) holding '\r', '\n' or the separator (or end if there is none)
+// the csv helpers below are all built on this; the localization files are large enough for it to matter
+char const* csv_find_stop(char const* start, char const* end, char seperator) {
+#if defined(__AVX2__)
+	{
+		auto const v_cr = _mm256_set1_epi8('\r');
+		auto const v_lf = _mm256_set1_epi8('\n');
+		auto const v_sep = _mm256_set1_epi8(seperator);
+		while(end - start >= 32) {
+			auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(start));
+			auto m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, v_cr), _mm256_cmpeq_epi8(v, v_lf)), _mm256_cmpeq_epi8(v, v_sep));
+			auto bits = uint32_t(_mm256_movemask_epi8(m));
+			if(bits != 0)
+				return start + std::countr_zero(bits);
+			start += 32;
+		}
+	}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	{
+		auto const v_cr = _mm_set1_epi8('\r');
+		auto const v_lf = _mm_set1_epi8('\n');
+		auto const v_sep = _mm_set1_epi8(seperator);
+		while(end - start >= 16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(start));
+			auto m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, v_cr), _mm_cmpeq_epi8(v, v_lf)), _mm_cmpeq_epi8(v, v_sep));
+			auto bits = uint32_t(_mm_movemask_epi8(m));
+			if(bits != 0)
+				return start + std::countr_zero(bits);
+			start += 16;
+		}
+	}
+#endif
 	while(start != end) {
-		if(line_termination(*start))
-			return separator_scan_result{start, false};
-		else if(*start == seperator)
-			return separator_scan_result{start, true};
-		else
-			++start;
+		if(line_termination(*start) || *start == seperator)
+			return start;
+		++start;
 	}
-	return separator_scan_result{start, false};
+	return start;
+}
+
+separator_scan_result csv_find_separator_token(char const* start, char const* end, char seperator) {
+	start = csv_find_stop(start, end, seperator);
+	return separator_scan_result{start, start != end && *start == seperator};
 }
 
 char const* csv_advance(char const* start, char const* end, char seperator) {
-	while(start != end) {
-		if(line_termination(*start))
-			return start;
-		else if(*start == seperator)
-			return start + 1;
-		else
-			++start;
-	}
+	start = csv_find_stop(start, end, seperator);
+	if(start != end && *start == seperator)
+		return start + 1;
 	return start;
 }
 
@@ -300,30 +419,25 @@ char const* csv_advance_n(uint32_t n, char const* start, char const* end, char s
 	--n;
 
 	while(start != end) {
-		if(line_termination(*start))
+		start = csv_find_stop(start, end, seperator);
+		if(start == end || line_termination(*start))
 			return start;
-		else if(*start == seperator) {
-			if(n == 0)
-				return start + 1;
-			else
-				--n;
-		}
+		if(n == 0)
+			return start + 1;
+		--n;
 		++start;
 	}
 	return start;
 }
 
 char const* csv_advance_to_next_line(char const* start, char const* end) {
-
-	while(start != end && !line_termination(*start)) {
-		++start;
+	while(true) {
+		start = csv_find_stop(start, end, '\n');
+		while(start != end && line_termination(*start))
+			++start;
+		if(start == end || *start != '#')
+			return start;
 	}
-	while(start != end && line_termination(*start))
-		++start;
-	if(start == end || *start != '#')
-		return start;
-	else
-		return csv_advance_to_next_line(start, end);
 }
 
 std::string_view remove_surrounding_whitespace(std::string_view txt) {
@@ -16,11 +16,24 @@ struct token_and_type {
 	token_type type = token_type::unknown;
 };
 
+// character class bitmasks for one 64 byte block of a file, one bit per byte
+struct classified_block {
+	char const* base = nullptr;
+	uint64_t whitespace = 0; // see ignorable_char
+	uint64_t breaking = 0; // whitespace, braces, comment starts and = < > !
+	uint64_t newline = 0;
+	uint64_t line_end = 0;
+	uint64_t double_quote_end = 0;
+	uint64_t single_quote_end = 0;
+};
+
 class token_generator {
 private:
+	char const* file_start = nullptr;
 	char const* position = nullptr;
 	char const* file_end = nullptr;
 	int32_t current_line = 1;
+	classified_block block;
 
 	token_and_type peek_1;
 	token_and_type peek_2;
@@ -29,7 +42,7 @@ private:
 
 public:
 	token_generator() { }
-	token_generator(char const* file_start, char const* fe) : position(file_start), file_end(fe) { }
+	token_generator(char const* fs, char const* fe) : file_start(fs), position(fs), file_end(fe) { }
 	bool at_end() const {
 		return peek_2.type == token_type::unknown && peek_1.type == token_type::unknown && position >= file_end;
 	}
@@ -116,6 +129,7 @@ struct separator_scan_result {
 	bool found = false;
 };
 
+char const* csv_find_stop(char const* start, char const* end, char seperator);
 char const* csv_advance(char const* start, char const* end, char seperator);
 char const* csv_advance_n(uint32_t n, char const* start, char const* end, char seperator);
 char const* csv_advance_to_next_line(char const* start, char const* end);
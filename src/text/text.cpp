@@ -1,4 +1,8 @@
 #include <string_view>
+#include <cstring>
+#include <charconv>
+#include <span>
+#include <algorithm>
 
 #include "text.hpp"
 #include "system_state.hpp"
@@ -7,7 +11,10 @@
 #include <type_traits>
 #ifdef _WIN32
 #include <icu.h>
+#include <ppl.h>
 #else
+#include "oneapi/tbb.h"
+namespace concurrency = tbb;
 #include <unicode/ubrk.h>
 #include <unicode/utypes.h>
 #include <unicode/ubidi.h>
@@ -92,24 +99,237 @@ bool codepoint_is_line_break(uint32_t c) noexcept {
 	return  c == 0x2029 || c == 0x2028 || c == uint32_t('\n') || c == uint32_t('\r');
 }
 
-void consume_csv_file(sys::state& state, char const* file_content, uint32_t file_size, int32_t target_column) {
-	auto cpos = file_content;
+void add_keys_utf8(sys::state& state, std::span<std::string_view const> keys, std::span<dcon::text_key> results) {
+	assert(keys.size() == results.size());
+	// hashing is the only part that does not touch the pool, so it is done up front for every key at once
+	std::vector<uint64_t> hashes(keys.size());
+	concurrency::parallel_for(size_t(0), keys.size(), [&](size_t i) {
+		hashes[i] = detail::ci_wyhash(keys[i].data(), keys[i].size());
+	});
 
+	size_t total_bytes = 0;
+	for(auto k : keys)
+		total_bytes += k.length() + key_header_size + 1;
+	state.key_data.reserve(state.key_data.size() + total_bytes);
+	state.untrans_key_to_text_sequence.reserve(state.untrans_key_to_text_sequence.size() + keys.size());
+
+	for(size_t i = 0; i < keys.size(); ++i)
+		results[i] = state.add_key_utf8(hashed_key{ keys[i], hashes[i] });
+}
+
+namespace {
+
+void intern_csv_row(sys::state& state, dcon::text_key key, std::string_view key_text, std::string_view value, locale_cache_builder* cache) {
+	auto entry = state.add_locale_data_utf8(value);
+	state.locale_key_to_text_sequence.insert_or_assign(key, entry);
+
+	if(cache) {
+		locale_cache_entry e;
+		e.key_offset = uint32_t(cache->key_bytes.size());
+		e.key_length = uint32_t(key_text.length());
+		cache->key_bytes.insert(cache->key_bytes.end(), key_text.begin(), key_text.end());
+		if(value.length() > 0) {
+			e.text_offset = uint32_t(cache->text_bytes.size());
+			cache->text_bytes.insert(cache->text_bytes.end(), value.begin(), value.end());
+			cache->text_bytes.push_back(0);
+		} else {
+			e.text_offset = locale_cache_entry::no_text;
+		}
+		cache->entries.push_back(e);
+	}
+}
+
+char const* skip_csv_bom(char const* file_content, uint32_t file_size) {
 	if(file_size >= 3) {
 		// skip utf8 BOM if present
 		// 0xEF, 0xBB, 0xBF)
 		if(int(file_content[0]) == 0xEF && int(file_content[1]) == 0xBB && int(file_content[2]) == 0xBF)
-			cpos += 3;
+			return file_content + 3;
 	}
+	return file_content;
+}
+
+struct csv_segment {
+	char const* start = nullptr;
+	char const* end = nullptr;
+	std::vector<std::pair<std::string_view, std::string_view>> rows;
+};
+
+constexpr uint32_t csv_segment_size = 1024 * 1024;
+
+}
+
+void consume_csv_file(sys::state& state, char const* file_content, uint32_t file_size, int32_t target_column, locale_cache_builder* cache) {
+	auto cpos = skip_csv_bom(file_content, file_size);
 	while(cpos < file_content + file_size) {
 		cpos = parsers::parse_fixed_amount_csv_values<14>(cpos, file_content + file_size, ';', [&](std::string_view const* values) {
-			auto key = state.add_key_utf8(values[0]);
-			auto entry = state.add_locale_data_utf8(values[target_column]);
-			state.locale_key_to_text_sequence.insert_or_assign(key, entry);
+			intern_csv_row(state, state.add_key_utf8(values[0]), values[0], values[target_column], cache);
 		});
 	}
 }
 
+void consume_csv_files(sys::state& state, std::vector<simple_fs::file_contents> const& files, int32_t target_column, locale_cache_builder* cache) {
+	// split every file into segments that begin at a row boundary, so that the rows can be
+	// tokenized independently. only the interning afterwards touches the state, and it runs
+	// in file and segment order, so key_data comes out the same as it would from consume_csv_file
+	std::vector<csv_segment> segments;
+	for(auto& f : files) {
+		auto end = f.data + f.file_size;
+		auto cpos = skip_csv_bom(f.data, f.file_size);
+		bool first = true;
+		while(cpos < end) {
+			auto seg_end = (end - cpos) > csv_segment_size ? cpos + csv_segment_size : end;
+			if(seg_end != end) {
+				seg_end = parsers::csv_find_stop(seg_end, end, '\n');
+				while(seg_end != end && (*seg_end == '\r' || *seg_end == '\n'))
+					++seg_end;
+			}
+			auto seg_start = cpos;
+			// a row that starts with # is a comment everywhere except at the very top of the file
+			if(!first && seg_start != seg_end && *seg_start == '#')
+				seg_start = parsers::csv_advance_to_next_line(seg_start, seg_end);
+			segments.push_back(csv_segment{ seg_start, seg_end, { } });
+			cpos = seg_end;
+			first = false;
+		}
+	}
+
+	concurrency::parallel_for(size_t(0), segments.size(), [&](size_t i) {
+		auto& seg = segments[i];
+		auto cpos = seg.start;
+		while(cpos < seg.end) {
+			cpos = parsers::parse_fixed_amount_csv_values<14>(cpos, seg.end, ';', [&](std::string_view const* values) {
+				seg.rows.emplace_back(values[0], values[target_column]);
+			});
+		}
+	});
+
+	size_t total_rows = 0;
+	for(auto& seg : segments)
+		total_rows += seg.rows.size();
+	state.locale_key_to_text_sequence.reserve(state.locale_key_to_text_sequence.size() + total_rows);
+	if(cache)
+		cache->entries.reserve(cache->entries.size() + total_rows);
+
+	std::vector<std::string_view> keys;
+	keys.reserve(total_rows);
+	for(auto& seg : segments) {
+		for(auto& r : seg.rows)
+			keys.push_back(r.first);
+	}
+	std::vector<dcon::text_key> interned(total_rows);
+	add_keys_utf8(state, keys, interned);
+
+	size_t row = 0;
+	for(auto& seg : segments) {
+		for(auto& r : seg.rows)
+			intern_csv_row(state, interned[row++], r.first, r.second, cache);
+	}
+}
+
+namespace {
+
+constexpr uint32_t locale_cache_magic = 0x434F4C41; // 'ALOC'
+constexpr uint32_t locale_cache_version = 1;
+
+struct locale_cache_header {
+	uint32_t magic = locale_cache_magic;
+	uint32_t version = locale_cache_version;
+	uint64_t source_hash = 0;
+	uint32_t entry_count = 0;
+	uint32_t key_bytes = 0;
+	uint32_t text_bytes = 0;
+	uint32_t padding = 0;
+};
+
+native_string locale_cache_file_name(std::string_view locale_name) {
+	return NATIVE("locale_") + simple_fs::utf8_to_native(locale_name) + NATIVE(".cache");
+}
+
+}
+
+uint64_t locale_source_hash(uint64_t running_hash, std::string_view file_name, char const* file_content, uint32_t file_size) {
+	auto name_hash = ankerl::unordered_dense::detail::wyhash::hash(file_name.data(), file_name.length());
+	auto content_hash = ankerl::unordered_dense::detail::wyhash::hash(file_content, file_size);
+	running_hash = ankerl::unordered_dense::detail::wyhash::mix(running_hash ^ name_hash, uint64_t(file_size) ^ 0x9E3779B97F4A7C15ull);
+	return ankerl::unordered_dense::detail::wyhash::mix(running_hash, content_hash);
+}
+
+bool load_locale_cache(sys::state& state, std::string_view locale_name, uint64_t source_hash) {
+	auto settings_location = simple_fs::get_or_create_settings_directory();
+	auto cache_file = simple_fs::open_file(settings_location, locale_cache_file_name(locale_name));
+	if(!cache_file)
+		return false;
+
+	auto content = simple_fs::view_contents(*cache_file);
+	if(content.file_size < sizeof(locale_cache_header))
+		return false;
+
+	locale_cache_header header;
+	std::memcpy(&header, content.data, sizeof(locale_cache_header));
+	if(header.magic != locale_cache_magic || header.version != locale_cache_version || header.source_hash != source_hash)
+		return false;
+	if(uint64_t(content.file_size) != sizeof(locale_cache_header) + uint64_t(header.entry_count) * sizeof(locale_cache_entry) + header.key_bytes + header.text_bytes)
+		return false;
+
+	auto entries_start = content.data + sizeof(locale_cache_header);
+	auto keys_start = entries_start + header.entry_count * sizeof(locale_cache_entry);
+	auto text_start = keys_start + header.key_bytes;
+
+	// every entry is checked before anything is added to the state, so that a damaged cache leaves nothing behind and
+	// the caller can fall back to the csv files
+	std::vector<locale_cache_entry> entries(header.entry_count);
+	std::vector<std::string_view> keys;
+	keys.reserve(header.entry_count);
+	for(uint32_t i = 0; i < header.entry_count; ++i) {
+		auto& e = entries[i];
+		std::memcpy(&e, entries_start + i * sizeof(locale_cache_entry), sizeof(locale_cache_entry));
+		if(uint64_t(e.key_offset) + e.key_length > header.key_bytes || (e.text_offset != locale_cache_entry::no_text && e.text_offset >= header.text_bytes))
+			return false;
+		keys.push_back(std::string_view(keys_start + e.key_offset, e.key_length));
+	}
+
+	// the text blob is already laid out the way add_locale_data_utf8 would have appended it
+	auto text_base = uint32_t(state.locale_text_data.size());
+	state.locale_text_data.resize(text_base + header.text_bytes);
+	std::memcpy(state.locale_text_data.data() + text_base, text_start, header.text_bytes);
+
+	state.locale_key_to_text_sequence.reserve(state.locale_key_to_text_sequence.size() + header.entry_count);
+	state.untrans_key_to_text_sequence.reserve(state.untrans_key_to_text_sequence.size() + header.entry_count);
+
+	std::vector<dcon::text_key> interned(keys.size());
+	add_keys_utf8(state, keys, interned);
+	for(size_t i = 0; i < keys.size(); ++i) {
+		auto entry = entries[i].text_offset == locale_cache_entry::no_text ? uint32_t(0) : text_base + entries[i].text_offset;
+		state.locale_key_to_text_sequence.insert_or_assign(interned[i], entry);
+	}
+	return true;
+}
+
+void save_locale_cache(sys::state& state, std::string_view locale_name, uint64_t source_hash, locale_cache_builder const& cache) {
+	locale_cache_header header;
+	header.source_hash = source_hash;
+	header.entry_count = uint32_t(cache.entries.size());
+	header.key_bytes = uint32_t(cache.key_bytes.size());
+	header.text_bytes = uint32_t(cache.text_bytes.size());
+
+	std::vector<char> buffer(sizeof(locale_cache_header) + cache.entries.size() * sizeof(locale_cache_entry) + cache.key_bytes.size() + cache.text_bytes.size());
+	auto ptr = buffer.data();
+	std::memcpy(ptr, &header, sizeof(locale_cache_header));
+	ptr += sizeof(locale_cache_header);
+	if(!cache.entries.empty())
+		std::memcpy(ptr, cache.entries.data(), cache.entries.size() * sizeof(locale_cache_entry));
+	ptr += cache.entries.size() * sizeof(locale_cache_entry);
+	if(!cache.key_bytes.empty())
+		std::memcpy(ptr, cache.key_bytes.data(), cache.key_bytes.size());
+	ptr += cache.key_bytes.size();
+	if(!cache.text_bytes.empty())
+		std::memcpy(ptr, cache.text_bytes.data(), cache.text_bytes.size());
+
+	auto settings_location = simple_fs::get_or_create_settings_directory();
+	simple_fs::write_file(settings_location, locale_cache_file_name(locale_name), buffer.data(), uint32_t(buffer.size()));
+}
+
 template<size_t N>
 bool is_fixed_token_ci(std::string_view v, char const (&t)[N]) {
 	if(v.length() != (N - 1))
@@ -603,74 +823,41 @@ char16_t win1250toUTF16(char in) {
 	return converted[(uint8_t)in];
 }
 
-std::string produce_simple_string(sys::state const& state, dcon::text_key id) {
-	std::string result;
-
-	if(!id)
-		return result;
+namespace impl {
 
+// the text behind a key and its tokens: compiled at locale load for localized text, otherwise tokenized into scratch
+std::string_view key_template(sys::state const& state, dcon::text_key key, std::vector<template_token>& scratch, std::span<template_token const>& tokens) {
 	std::string_view sv;
-	if(auto it = state.locale_key_to_text_sequence.find(id); it != state.locale_key_to_text_sequence.end()) {
+	if(auto it = state.locale_key_to_text_sequence.find(key); it != state.locale_key_to_text_sequence.end()) {
 		sv = state.locale_string_view(it->second);
+		if(auto t = state.locale_templates.find(it->second); t != state.locale_templates.end()) {
+			tokens = std::span<template_token const>(state.locale_template_tokens.data() + t->second.first, t->second.count);
+			return sv;
+		}
 	} else {
-		sv = state.to_string_view(id);
+		sv = state.to_string_view(key);
 	}
+	scratch.clear();
+	compile_template(sv, scratch);
+	tokens = std::span<template_token const>(scratch.data(), scratch.size());
+	return sv;
+}
 
-	char const* section_start = sv.data();
-	for(char const* pos = sv.data(); pos < sv.data() + sv.length();) {
-		bool colour_esc = false;
-		if(pos + 1 < sv.data() + sv.length() && uint8_t(*pos) == 0xC2 && uint8_t(*(pos + 1)) == 0xA7) {
-			if(section_start < pos)
-				result += std::string_view(section_start, pos - section_start);
-
-			pos += 2;
-			section_start = pos;
-			if(pos < sv.data() + sv.length()) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(pos + 2 < sv.data() + sv.length() && uint8_t(*pos) == 0xEF && uint8_t(*(pos + 1)) == 0xBF && uint8_t(*(pos + 2)) == 0xBD && is_qmark_color(*(pos + 3))) {
-			if(section_start < pos)
-				result += std::string_view(section_start, pos - section_start);
-
-			section_start = pos += 3;
-
-			if(pos < sv.data() + sv.length()) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(pos + 1 < sv.data() + sv.length() && *pos == '?' && is_qmark_color(*(pos + 1))) {
-			if(section_start < pos)
-				result += std::string_view(section_start, pos - section_start);
-
-			pos += 1;
-			section_start = pos;
+} // namespace impl
 
-			if(pos < sv.data() + sv.length()) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(*pos == '$') {
-			if(section_start < pos)
-				result += std::string_view(section_start, pos - section_start);
+std::string produce_simple_string(sys::state const& state, dcon::text_key id) {
+	std::string result;
 
-			const char* vend = pos + 1;
-			for(; vend != sv.data() + sv.length() && *vend != '$'; ++vend)
-				;
+	if(!id)
+		return result;
 
-			pos = vend + 1;
-			section_start = pos;
-		} else if(pos + 1 < sv.data() + sv.length() && *pos == '\\' && *(pos + 1) == 'n') {
-			result += std::string_view(section_start, pos - section_start);
-			section_start = pos += 2;
-		} else {
-			++pos;
-		}
+	std::vector<template_token> scratch;
+	std::span<template_token const> tokens;
+	auto sv = impl::key_template(state, id, scratch, tokens);
+	for(auto& t : tokens) {
+		if(t.type == template_token_type::text || t.type == template_token_type::icon)
+			result += sv.substr(t.start, t.length);
 	}
-
-	if(section_start < sv.data() + sv.length())
-		result += std::string_view(section_start, (sv.data() + sv.length()) - section_start);
-
 	return result;
 }
 std::string produce_simple_string(sys::state const& state, std::string_view txt) {
@@ -685,66 +872,58 @@ dcon::text_key find_or_add_key(sys::state& state, std::string_view key) {
 	return state.add_key_utf8(key);
 }
 
-std::string prettify_currency(float num) {
-	constexpr static double mag[] = {
-		1.0,
-		1'000.0,
-		1'000'000.0,
-		1'000'000'000.0,
-		1'000'000'000'000.0,
-		1'000'000'000'000'000.0,
-		1'000'000'000'000'000'000.0
-	};
-	constexpr static char const* sufx_two[] = {
-		"%.2f £",
-		"%.2fK £",
-		"%.2fM £",
-		"%.2fB £",
-		"%.2fT £",
-		"%.2fP £",
-		"%.2fZ £"
-	};
-	constexpr static char const* sufx_one[] = {
-		"%.1f £",
-		"%.1fK £",
-		"%.1fM £",
-		"%.1fB £",
-		"%.1fT £",
-		"%.1fP £",
-		"%.1fZ £"
-	};
-	constexpr static char const* sufx_zero[] = {
-		"%.1f £",
-		"%.1fK £",
-		"%.1fM £",
-		"%.1fB £",
-		"%.1fT £",
-		"%.1fP £",
-		"%.1fZ £"
-	};
-	char buffer[200] = { 0 };
-	double dval = double(num);
-	if(std::abs(dval) <= 1.f) {
-		snprintf(buffer, sizeof(buffer), sufx_two[0], float(dval));
-		return std::string(buffer);
-	}
-	for(size_t i = std::extent_v<decltype(mag)>; i-- > 0;) {
-		if(std::abs(dval) >= mag[i]) {
-			auto reduced = dval / mag[i];
-			if(std::abs(reduced) < 10.0) {
-				snprintf(buffer, sizeof(buffer), sufx_two[i], float(reduced));
-			} else if(std::abs(reduced) < 100.0) {
-				snprintf(buffer, sizeof(buffer), sufx_one[i], float(reduced));
-			} else {
-				snprintf(buffer, sizeof(buffer), sufx_zero[i], float(reduced));
-			}
-			return std::string(buffer);
+std::string number_buffer::to_string() const {
+	std::string result;
+	result.reserve(length);
+	for(uint32_t i = 0; i < length; ++i) {
+		auto c = uint32_t(data[i]);
+		if(c < 0x80) {
+			result.push_back(char(c));
+		} else if(c < 0x800) {
+			result.push_back(char(0xC0 | (c >> 6)));
+			result.push_back(char(0x80 | (c & 0x3F)));
+		} else {
+			result.push_back(char(0xE0 | (c >> 12)));
+			result.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+			result.push_back(char(0x80 | (c & 0x3F)));
 		}
 	}
-	return std::string("#inf");
+	return result;
 }
 
-std::string prettify_float(float num) {
+namespace impl {
+
+void nb_append(number_buffer& out, char16_t c) {
+	if(out.length < number_buffer::capacity)
+		out.data[out.length++] = c;
+}
+void nb_append(number_buffer& out, std::string_view ascii) {
+	for(auto c : ascii)
+		nb_append(out, char16_t(c));
+}
+void nb_append_fixed(number_buffer& out, double value, int32_t places, number_format const& fmt) {
+	char buffer[number_buffer::capacity];
+	auto res = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, places);
+	for(auto p = buffer; p < res.ptr; ++p)
+		nb_append(out, *p == '.' ? fmt.decimal_point : char16_t(*p));
+}
+void nb_append_integer(number_buffer& out, int64_t value) {
+	char buffer[24];
+	auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	nb_append(out, std::string_view(buffer, res.ptr - buffer));
+}
+// a zero with the given number of places, as in 0.00
+void nb_append_zero(number_buffer& out, int32_t places, number_format const& fmt) {
+	nb_append(out, u'0');
+	if(places > 0)
+		nb_append(out, fmt.decimal_point);
+	for(int32_t i = 0; i < places; ++i)
+		nb_append(out, u'0');
+}
+
+// the value scaled down to its largest magnitude with a K, M, B, ... suffix; two places below 10, one below 100 and
+// large_places above that. whole numbers smaller than 1000 are written without any places
+bool nb_append_prettified(number_buffer& out, double dval, int32_t large_places, bool whole, number_format const& fmt) {
 	constexpr static double mag[] = {
 		1.0,
 		1'000.0,
@@ -754,195 +933,127 @@ std::string prettify_float(float num) {
 		1'000'000'000'000'000.0,
 		1'000'000'000'000'000'000.0
 	};
-	constexpr static char const* sufx_two[] = {
-		"%.2f",
-		"%.2fK",
-		"%.2fM",
-		"%.2fB",
-		"%.2fT",
-		"%.2fP",
-		"%.2fZ"
-	};
-	constexpr static char const* sufx_one[] = {
-		"%.1f",
-		"%.1fK",
-		"%.1fM",
-		"%.1fB",
-		"%.1fT",
-		"%.1fP",
-		"%.1fZ"
-	};
-	constexpr static char const* sufx_zero[] = {
-		"%.1f",
-		"%.1fK",
-		"%.1fM",
-		"%.1fB",
-		"%.1fT",
-		"%.1fP",
-		"%.1fZ"
-	};
-	char buffer[200] = { 0 };
-	double dval = double(num);
-	if(std::abs(dval) <= 1.f) {
-		snprintf(buffer, sizeof(buffer), sufx_two[0], float(dval));
-		return std::string(buffer);
-	}
+	constexpr static char16_t sufx[] = { 0, u'K', u'M', u'B', u'T', u'P', u'Z' };
+
 	for(size_t i = std::extent_v<decltype(mag)>; i-- > 0;) {
 		if(std::abs(dval) >= mag[i]) {
 			auto reduced = dval / mag[i];
-			if(std::abs(reduced) < 10.0) {
-				snprintf(buffer, sizeof(buffer), sufx_two[i], float(reduced));
-			} else if(std::abs(reduced) < 100.0) {
-				snprintf(buffer, sizeof(buffer), sufx_one[i], float(reduced));
-			} else {
-				snprintf(buffer, sizeof(buffer), sufx_zero[i], float(reduced));
-			}
-			return std::string(buffer);
+			int32_t places = std::abs(reduced) < 10.0 ? 2 : (std::abs(reduced) < 100.0 ? 1 : large_places);
+			if(whole && i == 0)
+				places = 0;
+			nb_append_fixed(out, double(float(reduced)), places, fmt);
+			if(sufx[i])
+				nb_append(out, sufx[i]);
+			return true;
 		}
 	}
-	return std::string("#inf");
+	nb_append(out, "#inf");
+	return false;
 }
 
-std::string prettify(int64_t num) {
-	if(num == 0)
-		return std::string("0");
-
-	constexpr static double mag[] = {
-		1.0,
-		1'000.0,
-		1'000'000.0,
-		1'000'000'000.0,
-		1'000'000'000'000.0,
-		1'000'000'000'000'000.0,
-		1'000'000'000'000'000'000.0
-	};
-	constexpr static char const* sufx_two[] = {
-		"%.0f",
-		"%.2fK",
-		"%.2fM",
-		"%.2fB",
-		"%.2fT",
-		"%.2fP",
-		"%.2fZ"
-	};
-	constexpr static char const* sufx_one[] = {
-		"%.0f",
-		"%.1fK",
-		"%.1fM",
-		"%.1fB",
-		"%.1fT",
-		"%.1fP",
-		"%.1fZ"
-	};
-	constexpr static char const* sufx_zero[] = {
-		"%.0f",
-		"%.0fK",
-		"%.0fM",
-		"%.0fB",
-		"%.0fT",
-		"%.0fP",
-		"%.0fZ"
-	};
+} // namespace impl
 
-	char buffer[200] = { 0 };
+void prettify_currency(number_buffer& out, float num, number_format const& fmt) {
+	out.length = 0;
 	double dval = double(num);
-	for(size_t i = std::extent_v<decltype(mag)>; i-- > 0;) {
-		if(std::abs(dval) >= mag[i]) {
-			auto reduced = dval / mag[i];
-			if(std::abs(reduced) < 10.0) {
-				snprintf(buffer, sizeof(buffer), sufx_two[i], float(reduced));
-			} else if(std::abs(reduced) < 100.0) {
-				snprintf(buffer, sizeof(buffer), sufx_one[i], float(reduced));
-			} else {
-				snprintf(buffer, sizeof(buffer), sufx_zero[i], float(reduced));
-			}
-			return std::string(buffer);
-		}
+	if(std::abs(dval) <= 1.f) {
+		impl::nb_append_fixed(out, double(float(dval)), 2, fmt);
+	} else if(!impl::nb_append_prettified(out, dval, 1, false, fmt)) {
+		return;
 	}
-	return std::string("#inf");
-}
-
-std::string format_percentage(float num, size_t digits) {
-	return format_float(num * 100.f, digits) + '%';
+	impl::nb_append(out, u' ');
+	impl::nb_append(out, u'\u00A3');
 }
 
-std::string format_float(float num, size_t digits) {
-	char buffer[200] = {0};
-	switch(digits) {
-	default:
-		// fallthrough
-	case 3:
-		if(num == 0.f) {
-			return std::string("0.000");
-		} else if(num > 0.f && num < 0.001f) {
-			return std::string(">0.000");
-		} else if(num > -0.001f && num < 0.f) {
-			return std::string("<0.000");
-		}
-		snprintf(buffer, sizeof(buffer), "%.3f", num);
-		break;
-	case 2:
-		if(num == 0.f) {
-			return std::string("0.00");
-		} else if(num > 0.f && num < 0.01f) {
-			return std::string(">0.00");
-		} else if(num > -0.01f && num < 0.f) {
-			return std::string("<0.00");
-		}
-		snprintf(buffer, sizeof(buffer), "%.2f", num);
-		break;
-	case 1:
-		if(num == 0.f) {
-			return std::string("0.0");
-		} else if(num > 0.f && num < 0.1f) {
-			return std::string(">0.0");
-		} else if(num > -0.1f && num < 0.f) {
-			return std::string("<0.0");
-		}
-		snprintf(buffer, sizeof(buffer), "%.1f", num);
-		break;
-	case 0:
-		if(num == 0.f) {
-			return std::string("0");
-		} else if(num > 0.f && num < 1.f) {
-			return std::string(">0");
-		} else if(num > -1.f && num < 0.f) {
-			return std::string("<0");
-		}
-		return std::to_string(int64_t(num));
+void prettify_float(number_buffer& out, float num, number_format const& fmt) {
+	out.length = 0;
+	double dval = double(num);
+	if(std::abs(dval) <= 1.f) {
+		impl::nb_append_fixed(out, double(float(dval)), 2, fmt);
+		return;
 	}
-	return std::string(buffer);
+	impl::nb_append_prettified(out, dval, 1, false, fmt);
 }
 
-std::string format_wholenum(int32_t num) {
-	std::string result;
-
+void prettify(number_buffer& out, int64_t num, number_format const& fmt) {
+	out.length = 0;
 	if(num == 0) {
-		result = "0";
-		return result;
+		impl::nb_append(out, u'0');
+		return;
 	}
+	impl::nb_append_prettified(out, double(num), 0, true, fmt);
+}
 
-	auto abs_value = num >= 0 ? num : -num;
-
-	int32_t pcount = 0;
-	while(abs_value > 0) {
-		if(pcount == 3) {
-			result.push_back(',');
-		}
-		auto last = abs_value % 10;
-		abs_value /= 10;
+void format_percentage(number_buffer& out, float num, size_t digits, number_format const& fmt) {
+	format_float(out, num * 100.f, digits, fmt);
+	impl::nb_append(out, u'%');
+}
 
-		result.push_back(char('0' + last));
+void format_float(number_buffer& out, float num, size_t digits, number_format const& fmt) {
+	constexpr static float smallest[] = { 1.f, 0.1f, 0.01f, 0.001f };
 
-		++pcount;
+	out.length = 0;
+	auto places = int32_t(std::min(digits, size_t(3)));
+	if(num == 0.f) {
+		impl::nb_append_zero(out, places, fmt);
+	} else if(num > 0.f && num < smallest[places]) {
+		impl::nb_append(out, u'>');
+		impl::nb_append_zero(out, places, fmt);
+	} else if(num > -smallest[places] && num < 0.f) {
+		impl::nb_append(out, u'<');
+		impl::nb_append_zero(out, places, fmt);
+	} else if(places == 0) {
+		impl::nb_append_integer(out, int64_t(num));
+	} else {
+		impl::nb_append_fixed(out, double(num), places, fmt);
 	}
+}
 
-	if(num < 0)
-		result.push_back('-');
+void format_wholenum(number_buffer& out, int32_t num, number_format const& fmt) {
+	out.length = 0;
+	char buffer[16];
+	auto abs_value = num >= 0 ? int64_t(num) : -int64_t(num);
+	auto res = std::to_chars(buffer, buffer + sizeof(buffer), abs_value);
+	auto count = int32_t(res.ptr - buffer);
 
-	std::reverse(result.begin(), result.end());
+	if(num < 0)
+		impl::nb_append(out, u'-');
+	for(int32_t i = 0; i < count; ++i) {
+		if(i != 0 && (count - i) % 3 == 0)
+			impl::nb_append(out, fmt.group_separator);
+		impl::nb_append(out, char16_t(buffer[i]));
+	}
+}
 
-	return result;
+std::string prettify_currency(float num) {
+	number_buffer b;
+	prettify_currency(b, num);
+	return b.to_string();
+}
+std::string prettify_float(float num) {
+	number_buffer b;
+	prettify_float(b, num);
+	return b.to_string();
+}
+std::string prettify(int64_t num) {
+	number_buffer b;
+	prettify(b, num);
+	return b.to_string();
+}
+std::string format_percentage(float num, size_t digits) {
+	number_buffer b;
+	format_percentage(b, num, digits);
+	return b.to_string();
+}
+std::string format_float(float num, size_t digits) {
+	number_buffer b;
+	format_float(b, num, digits);
+	return b.to_string();
+}
+std::string format_wholenum(int32_t num) {
+	number_buffer b;
+	format_wholenum(b, num);
+	return b.to_string();
 }
 
 std::string format_ratio(int32_t left, int32_t right) {
@@ -953,6 +1064,101 @@ void add_to_substitution_map(substitution_map& mp, variable_type key, substituti
 	mp.insert_or_assign(uint32_t(key), value);
 }
 
+void compile_template(std::string_view sv, std::vector<template_token>& out) {
+	char const* seq_start = sv.data();
+	char const* seq_end = sv.data() + sv.size();
+	char const* section_start = seq_start;
+
+	auto add_token = [&](char const* start, char const* end, template_token_type type, uint16_t value) {
+		out.push_back(template_token{ uint32_t(start - seq_start), uint32_t(end - start), type, value });
+	};
+	auto close_section = [&](char const* pos) {
+		if(section_start < pos)
+			add_token(section_start, pos, template_token_type::text, 0);
+	};
+
+	for(char const* pos = seq_start; pos < seq_end;) {
+		if(pos + 1 < seq_end && uint8_t(*pos) == 0xC2 && uint8_t(*(pos + 1)) == 0xA7) {
+			close_section(pos);
+			pos += 2;
+			if(pos < seq_end) {
+				add_token(pos - 2, pos + 1, template_token_type::color, uint16_t(char_to_color(*pos)));
+				pos += 1;
+			}
+			section_start = pos;
+		} else if(pos + 3 < seq_end && uint8_t(*pos) == 0xEF && uint8_t(*(pos + 1)) == 0xBF && uint8_t(*(pos + 2)) == 0xBD && is_qmark_color(*(pos + 3))) {
+			close_section(pos);
+			add_token(pos, pos + 4, template_token_type::color, uint16_t(char_to_color(*(pos + 3))));
+			section_start = pos += 4;
+		} else if(*pos == '@' && pos + 3 < seq_end && *(pos + 1) == '(' && *(pos + 3) == ')' && (*(pos + 2) == 'T' || *(pos + 2) == 'F')) {
+			close_section(pos);
+			add_token(pos, pos + 4, template_token_type::icon, uint16_t(*(pos + 2) == 'T' ? embedded_icon::check : embedded_icon::xmark));
+			section_start = pos += 4;
+		} else if(pos + 1 < seq_end && *pos == '?' && is_qmark_color(*(pos + 1))) {
+			close_section(pos);
+			add_token(pos, pos + 2, template_token_type::color, uint16_t(char_to_color(*(pos + 1))));
+			section_start = pos += 2;
+		} else if(*pos == '$') {
+			close_section(pos);
+			char const* vend = pos + 1;
+			for(; vend != seq_end && *vend != '$'; ++vend)
+				;
+			if(vend > pos + 1) {
+				add_token(pos, vend == seq_end ? seq_end : vend + 1, template_token_type::variable, uint16_t(variable_type_from_name(std::string_view(pos + 1, vend - pos - 1))));
+			}
+			pos = vend == seq_end ? seq_end : vend + 1;
+			section_start = pos;
+		} else if(pos + 1 < seq_end && *pos == '\\' && *(pos + 1) == 'n') {
+			close_section(pos);
+			add_token(pos, pos + 2, template_token_type::line_break, 0);
+			section_start = pos += 2;
+		} else {
+			++pos;
+		}
+	}
+	close_section(seq_end);
+}
+
+void compile_locale_templates(sys::state& state) {
+	state.locale_template_tokens.clear();
+	state.locale_templates.clear();
+
+	std::vector<uint32_t> offsets;
+	offsets.reserve(state.locale_key_to_text_sequence.size());
+	for(auto& e : state.locale_key_to_text_sequence)
+		offsets.push_back(e.second);
+	std::sort(offsets.begin(), offsets.end());
+	offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+	// blocks of strings are tokenized in parallel into their own lists, which are then joined in order
+	constexpr size_t block_size = 1024;
+	auto block_count = (offsets.size() + block_size - 1) / block_size;
+	std::vector<std::vector<template_token>> block_tokens(block_count);
+	std::vector<template_range> ranges(offsets.size());
+	concurrency::parallel_for(size_t(0), block_count, [&](size_t b) {
+		auto& tokens = block_tokens[b];
+		for(size_t i = b * block_size; i < std::min(offsets.size(), (b + 1) * block_size); ++i) {
+			auto first = uint32_t(tokens.size());
+			compile_template(state.locale_string_view(offsets[i]), tokens);
+			ranges[i] = template_range{ first, uint32_t(tokens.size()) - first };
+		}
+	});
+
+	size_t total_tokens = 0;
+	for(auto& b : block_tokens)
+		total_tokens += b.size();
+	state.locale_template_tokens.reserve(total_tokens);
+	state.locale_templates.reserve(offsets.size());
+	for(size_t b = 0; b < block_count; ++b) {
+		auto base = uint32_t(state.locale_template_tokens.size());
+		state.locale_template_tokens.insert(state.locale_template_tokens.end(), block_tokens[b].begin(), block_tokens[b].end());
+		for(size_t i = b * block_size; i < std::min(offsets.size(), (b + 1) * block_size); ++i) {
+			ranges[i].first += base;
+			state.locale_templates.insert_or_assign(offsets[i], ranges[i]);
+		}
+	}
+}
+
 
 text_chunk const* layout::get_chunk_from_position(int32_t x, int32_t y) const {
 	for(auto& chunk : contents) {
@@ -971,6 +1177,33 @@ endless_layout create_endless_layout(sys::state& state, layout& dest, layout_par
 
 namespace impl {
 
+// what kind of content was added to a layout, mixed into its content digest along with the content itself
+enum class lb_digest_item : uint8_t {
+	line_end, layout_line_break, icon, text, space, box_open, box_close
+};
+
+void lb_digest(layout_base& dest, uint64_t value) {
+	*dest.content_digest = ankerl::unordered_dense::detail::wyhash::mix(*dest.content_digest ^ value, 0x9E3779B97F4A7C15ull);
+}
+void lb_digest(layout_base& dest, lb_digest_item item, uint32_t value) {
+	lb_digest(dest, (uint64_t(item) << 32) | value);
+}
+void lb_digest(layout_base& dest, void const* data, size_t size) {
+	lb_digest(dest, ankerl::unordered_dense::detail::wyhash::hash(data, size));
+}
+void lb_digest(layout_base& dest, substitution const& source) {
+	lb_digest(dest, uint64_t(source.index()));
+	std::visit([&](auto const& v) {
+		using T = std::decay_t<decltype(v)>;
+		if constexpr(std::is_same_v<T, std::string_view>) {
+			lb_digest(dest, v.data(), v.size());
+		} else if constexpr(!std::is_same_v<T, std::monostate>) {
+			lb_digest(dest, &v, sizeof(T));
+		}
+	}, source);
+}
+
+// not digested here: in digest only mode nothing is wrapped, so only the breaks the caller asks for are hashed
 void lb_finish_line(layout_base& dest, layout_box& box, int32_t line_height) {
 	bool rtl = dest.native_rtl == layout_base::rtl_status::rtl;
 	if(dest.fixed_parameters.align == alignment::center) {
@@ -1014,22 +1247,33 @@ void lb_finish_line(layout_base& dest, layout_box& box, int32_t line_height) {
 void add_line_break_to_layout_box(sys::state& state, layout_base& dest, layout_box& box) {
 	auto text_height = int32_t(std::ceil(state.font_collection.line_height(state, dest.fixed_parameters.font_id)));
 	auto line_height = text_height + dest.fixed_parameters.leading;
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::line_end, uint32_t(line_height));
 	impl::lb_finish_line(dest, box, line_height);
 }
 void add_line_break_to_layout(sys::state& state, columnar_layout& dest) {
 	auto text_height = int32_t(std::ceil(state.font_collection.line_height(state, dest.fixed_parameters.font_id)));
 	auto line_height = text_height + dest.fixed_parameters.leading;
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::layout_line_break, uint32_t(line_height));
 	dest.base_layout.number_of_lines += 1;
 	dest.y_cursor += line_height;
 }
 void add_line_break_to_layout(sys::state& state, endless_layout& dest) {
 	auto text_height = int32_t(std::ceil(state.font_collection.line_height(state, dest.fixed_parameters.font_id)));
 	auto line_height = text_height + dest.fixed_parameters.leading;
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::layout_line_break, uint32_t(line_height));
 	dest.base_layout.number_of_lines += 1;
 	dest.y_cursor += line_height;
 }
 
 void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, embedded_icon ico) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::icon, uint32_t(ico));
+	if(dest.digest_only)
+		return;
+
 	auto v_amount = state.font_collection.get_font(state, text::font_index_from_font_id(state, dest.fixed_parameters.font_id)).retrieve_instance(state, text::size_from_font_id(dest.fixed_parameters.font_id)).ascender(state);
 
 	if(dest.native_rtl == layout_base::rtl_status::rtl) {
@@ -1078,6 +1322,13 @@ text::alignment to_text_alignment(ui::alignment in) {
 void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, std::u16string_view text, text_color color, substitution source) {
 	if(text.size() == 0)
 		return;
+	if(dest.content_digest) {
+		impl::lb_digest(dest, impl::lb_digest_item::text, uint32_t(color));
+		impl::lb_digest(dest, text.data(), text.size() * sizeof(char16_t));
+		impl::lb_digest(dest, source);
+	}
+	if(dest.digest_only)
+		return;
 
 	auto& font = state.font_collection.get_font(state, text::font_index_from_font_id(state, dest.fixed_parameters.font_id));
 	auto text_height = int32_t(std::ceil(state.font_collection.line_height(state, dest.fixed_parameters.font_id)));
@@ -1087,23 +1338,45 @@ void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, st
 	bool first_in_line = true;
 	auto font_size = text::size_from_font_id(dest.fixed_parameters.font_id);
 
-	UErrorCode errorCode = U_ZERO_ERROR;
-	UBreakIterator* lb_it = ubrk_openBinaryRules(state.font_collection.compiled_ubrk_rules.data(), int32_t(state.font_collection.compiled_ubrk_rules.size()), (UChar const*)text.data(), int32_t(text.size()), &errorCode);
-
-	if(!lb_it || !U_SUCCESS(errorCode)) {
-		std::abort(); // couldn't create iterator
-	}
+	text::break_iterator_lease lb_lease(state, text::break_type::line, text.data(), int32_t(text.size()));
+	auto lb_it = lb_lease.get();
 
 	ubrk_first(lb_it);
 
-	text::stored_glyphs all_glyphs(state, text::size_from_font_id(dest.fixed_parameters.font_id), text::font_index_from_font_id(state, dest.fixed_parameters.font_id), std::span<uint16_t>((uint16_t*)(const_cast<char16_t*>(text.data())), text.size()), text::stored_glyphs::no_bidi{});
-
+	text::stored_glyphs all_glyphs{ dest.base_layout.glyph_memory() };
+	all_glyphs.shape(state, text::size_from_font_id(dest.fixed_parameters.font_id), text::font_index_from_font_id(state, dest.fixed_parameters.font_id), std::span<uint16_t>((uint16_t*)(const_cast<char16_t*>(text.data())), text.size()), text::stored_glyphs::no_bidi{});
+	// the line breaking below measures many overlapping spans of these glyphs
+	all_glyphs.build_advance_index();
 
 	auto append_glyphs = [&](std::span<uint16_t> glyph_span, uint32_t cluster_start_position, int16_t extent) {
 		size_t details_glyphs_start_pos = dest.edit_details ? dest.edit_details->grapheme_placement.size() : size_t(0);
+		text::stored_glyphs chunk_glyphs{ dest.base_layout.glyph_memory() };
+		auto chunk_text = std::u16string_view((char16_t const*)glyph_span.data(), glyph_span.size());
+		auto cached = (dest.chunk_cache && dest.edit_details) ? dest.chunk_cache->find(chunk_text) : nullptr;
+		if(cached) {
+			chunk_glyphs.glyph_info.assign(cached->glyphs.glyph_info.begin(), cached->glyphs.glyph_info.end());
+			auto& placement = dest.edit_details->grapheme_placement;
+			auto base = int16_t(placement.size());
+			// shaping a chunk moves the last cluster of the previous chunk onto the current line
+			if(base != 0 && !cached->clusters.empty())
+				placement.back().line = dest.edit_details->total_lines;
+			for(auto c : cached->clusters) {
+				c.source_offset = uint16_t(c.source_offset + cluster_start_position);
+				c.line = dest.edit_details->total_lines;
+				if(c.visual_left != -1)
+					c.visual_left = int16_t(c.visual_left + base);
+				if(c.visual_right != -1)
+					c.visual_right = int16_t(c.visual_right + base);
+				placement.push_back(c);
+			}
+		} else {
+			chunk_glyphs.shape(state, text::size_from_font_id(dest.fixed_parameters.font_id), text::font_index_from_font_id(state, dest.fixed_parameters.font_id), glyph_span, cluster_start_position, dest.edit_details, dest.fixed_parameters.font_id);
+			if(dest.chunk_cache && dest.edit_details)
+				dest.chunk_cache->store(chunk_text, chunk_glyphs, *dest.edit_details, details_glyphs_start_pos, cluster_start_position);
+		}
 		dest.base_layout.contents.push_back(text_chunk{
-					text::stored_glyphs(state,text::size_from_font_id(dest.fixed_parameters.font_id), text::font_index_from_font_id(state, dest.fixed_parameters.font_id), glyph_span, cluster_start_position, dest.edit_details, dest.fixed_parameters.font_id),
-					box.x_position, (!dest.fixed_parameters.suppress_hyperlinks) ? source : std::monostate{}, int16_t(box.y_position), extent, int16_t(text_height), tmp_color });
+					std::move(chunk_glyphs),
+					box.x_position, (!dest.fixed_parameters.suppress_hyperlinks) ? source : std::monostate{}, int16_t(box.y_position), extent, int16_t(text_height), tmp_color, dest.fixed_parameters.effect });
 		if(dest.edit_details) {
 			for(size_t i = details_glyphs_start_pos; i < dest.edit_details->grapheme_placement.size(); ++i) {
 				auto& adjust_target = dest.edit_details->grapheme_placement[i];
@@ -1362,8 +1635,6 @@ void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, st
 			}
 		}
 	}
-
-	ubrk_close(lb_it);
 }
 
 
@@ -1396,38 +1667,51 @@ void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, st
 
 namespace impl {
 
-std::string lb_resolve_substitution(sys::state& state, substitution sub, substitution_map const& mp) {
-	if(std::holds_alternative<std::string_view>(sub)) {
-		return std::string(std::get<std::string_view>(sub));
-	} else if(std::holds_alternative<dcon::text_key>(sub)) {
-		auto tkey = std::get<dcon::text_key>(sub);
-		if(auto it = state.locale_key_to_text_sequence.find(tkey); it != state.locale_key_to_text_sequence.end()) {
-			return std::string(state.locale_string_view(it->second));
-		} else {
-			return std::string(state.to_string_view(tkey));
-		}
-	} else if(std::holds_alternative<int64_t>(sub)) {
-		return std::to_string(std::get<int64_t>(sub));
+// formats the numeric substitutions; false for anything else
+bool lb_format_numeric_substitution(number_buffer& out, substitution const& sub, number_format const& fmt) {
+	if(std::holds_alternative<int64_t>(sub)) {
+		out.length = 0;
+		nb_append_integer(out, std::get<int64_t>(sub));
 	} else if(std::holds_alternative<fp_one_place>(sub)) {
-		return text::format_float(std::get<fp_one_place>(sub).value, 1);
+		text::format_float(out, std::get<fp_one_place>(sub).value, 1, fmt);
 	} else if(std::holds_alternative<fp_two_places>(sub)) {
-		return text::format_float(std::get<fp_two_places>(sub).value, 2);
+		text::format_float(out, std::get<fp_two_places>(sub).value, 2, fmt);
 	} else if(std::holds_alternative<fp_three_places>(sub)) {
-		return text::format_float(std::get<fp_three_places>(sub).value, 3);
+		text::format_float(out, std::get<fp_three_places>(sub).value, 3, fmt);
 	} else if(std::holds_alternative<fp_four_places>(sub)) {
- 		return text::format_float(std::get<fp_four_places>(sub).value, 4);
+		text::format_float(out, std::get<fp_four_places>(sub).value, 4, fmt);
 	} else if(std::holds_alternative<pretty_integer>(sub)) {
-		return prettify(std::get<pretty_integer>(sub).value);
+		text::prettify(out, std::get<pretty_integer>(sub).value, fmt);
 	} else if(std::holds_alternative<fp_percentage>(sub)) {
-		return text::format_percentage(std::get<fp_percentage>(sub).value, 0);
+		text::format_percentage(out, std::get<fp_percentage>(sub).value, 0, fmt);
 	} else if(std::holds_alternative<fp_percentage_one_place>(sub)) {
-		return text::format_percentage(std::get<fp_percentage_one_place>(sub).value, 1);
+		text::format_percentage(out, std::get<fp_percentage_one_place>(sub).value, 1, fmt);
 	} else if(std::holds_alternative<fp_percentage_two_places>(sub)) {
-		return text::format_percentage(std::get<fp_percentage_two_places>(sub).value, 2);
+		text::format_percentage(out, std::get<fp_percentage_two_places>(sub).value, 2, fmt);
 	} else if(std::holds_alternative<int_percentage>(sub)) {
-		return std::to_string(std::get<int_percentage>(sub).value) + "%";
+		out.length = 0;
+		nb_append_integer(out, std::get<int_percentage>(sub).value);
+		nb_append(out, u'%');
 	} else if(std::holds_alternative<int_wholenum>(sub)) {
-		return text::format_wholenum(std::get<int_wholenum>(sub).value);
+		text::format_wholenum(out, std::get<int_wholenum>(sub).value, fmt);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+std::string lb_resolve_substitution(sys::state& state, substitution sub, substitution_map const& mp) {
+	if(number_buffer num; lb_format_numeric_substitution(num, sub, state.font_collection.numbers)) {
+		return num.to_string();
+	} else if(std::holds_alternative<std::string_view>(sub)) {
+		return std::string(std::get<std::string_view>(sub));
+	} else if(std::holds_alternative<dcon::text_key>(sub)) {
+		auto tkey = std::get<dcon::text_key>(sub);
+		if(auto it = state.locale_key_to_text_sequence.find(tkey); it != state.locale_key_to_text_sequence.end()) {
+			return std::string(state.locale_string_view(it->second));
+		} else {
+			return std::string(state.to_string_view(tkey));
+		}
 	} else {
 		return std::string("?");
 	}
@@ -1435,149 +1719,75 @@ std::string lb_resolve_substitution(sys::state& state, substitution sub, substit
 
 } // namespace impl
 
-void add_unparsed_text_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, std::string_view sv, substitution_map const& mp) {
-	if(sv.length() == 0)
-		return;
+namespace impl {
 
+void lb_add_template(sys::state& state, layout_base& dest, layout_box& box, std::string_view sv, std::span<template_token const> tokens, substitution_map const& mp) {
 	auto current_color = dest.fixed_parameters.color;
 
-	auto text_height = int32_t(std::ceil(state.font_collection.line_height(state, dest.fixed_parameters.font_id)));
-	auto line_height = text_height + dest.fixed_parameters.leading;
-
-	char const* seq_start = sv.data();
-	char const* seq_end = sv.data() + sv.size();
-	char const* section_start = seq_start;
-
-	auto add_text_range = [&](std::string_view sv) {
-		if(sv.length() > 0) {
-			add_to_layout_box(state, dest, box, sv, current_color, std::monostate{});
-		}
-	};
-
-	for(char const* pos = seq_start; pos < seq_end;) {
-		bool colour_esc = false;
-		if(pos + 1 < seq_end && uint8_t(*pos) == 0xC2 && uint8_t(*(pos + 1)) == 0xA7) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			pos += 2;
-			section_start = pos;
-			if(pos < seq_end) {
-				auto newcolor = char_to_color(*pos);
-				if(newcolor == text_color::reset)
-					current_color = dest.fixed_parameters.color;
-				else
-					current_color = newcolor;
-
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(pos + 4 < seq_end && uint8_t(*pos) == 0xEF && uint8_t(*(pos + 1)) == 0xBF && uint8_t(*(pos + 2)) == 0xBD && is_qmark_color(*(pos + 3))) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			section_start = pos += 3;
-
-			if(pos < seq_end) {
-				auto newcolor = char_to_color(*pos);
-				if(newcolor == text_color::reset)
-					current_color = dest.fixed_parameters.color;
-				else
-					current_color = newcolor;
-
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(*pos == '@' && pos + 3 < seq_end) {
-			if(*(pos + 1) == '(' && *(pos + 3) == ')') {
-				if(*(pos + 2) == 'T') {
-					if(section_start < pos)
-						add_text_range(std::string_view(section_start, pos - section_start));
-					add_to_layout_box(state, dest, box, embedded_icon::check);
-					pos += 4;
-					section_start = pos;
-				} else if(*(pos + 2) == 'F') {
-					if(section_start < pos)
-						add_text_range(std::string_view(section_start, pos - section_start));
-					add_to_layout_box(state, dest, box, embedded_icon::xmark);
-					pos += 4;
-					section_start = pos;
+	for(auto& t : tokens) {
+		auto source = sv.substr(t.start, t.length);
+		switch(t.type) {
+		case template_token_type::text:
+			add_to_layout_box(state, dest, box, source, current_color, std::monostate{});
+			break;
+		case template_token_type::color:
+			if(text_color(t.value) == text_color::reset)
+				current_color = dest.fixed_parameters.color;
+			else
+				current_color = text_color(t.value);
+			break;
+		case template_token_type::icon:
+			add_to_layout_box(state, dest, box, embedded_icon(t.value));
+			break;
+		case template_token_type::variable:
+			if(variable_type(t.value) == variable_type::error_no_matching_value) {
+				add_to_layout_box(state, dest, box, source, current_color, std::monostate{});
+			} else if(auto it = mp.find(uint32_t(t.value)); it != mp.end()) {
+				if(number_buffer num; lb_format_numeric_substitution(num, it->second, state.font_collection.numbers)) {
+					add_to_layout_box(state, dest, box, num.view(), current_color, it->second);
 				} else {
-					++pos;
+					auto txt = lb_resolve_substitution(state, it->second, mp);
+					add_to_layout_box(state, dest, box, std::string_view(txt), current_color, it->second);
 				}
 			} else {
-				++pos;
-			}
-		} else if(pos + 1 < seq_end && *pos == '?' && is_qmark_color(*(pos + 1))) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			pos += 1;
-			section_start = pos;
-			// This colour escape sequence must be followed by something, otherwise
-			// we should probably discard the last colour command
-			if(pos < seq_end) {
-
-				auto newcolor = char_to_color(*pos);
-				if(newcolor == text_color::reset)
-					current_color = dest.fixed_parameters.color;
-				else
-					current_color = newcolor;
-
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(*pos == '$') {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			const char* vend = pos + 1;
-			for(; vend != seq_end && *vend != '$'; ++vend)
-				;
-			if(vend > pos + 1) {
-				auto var_type = variable_type_from_name(std::string_view(pos + 1, vend - pos - 1));
-				if(var_type != variable_type::error_no_matching_value) {
-					if(auto it = mp.find(uint32_t(var_type)); it != mp.end()) {
-						auto txt = impl::lb_resolve_substitution(state, it->second, mp);
-						add_to_layout_box(state, dest, box, std::string_view(txt), current_color, it->second);
-					} else {
-						add_to_layout_box(state, dest, box, std::string_view("???"), current_color, std::monostate{});
-					}
-				} else {
-					add_to_layout_box(state, dest, box, std::string_view(pos, (vend - pos) + 1), current_color, std::monostate{});
-				}
+				add_to_layout_box(state, dest, box, std::string_view("???"), current_color, std::monostate{});
 			}
-			pos = vend + 1;
-			section_start = pos;
-		} else if(pos + 1 < seq_end && *pos == '\\' && *(pos + 1) == 'n') {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
+			break;
+		case template_token_type::line_break:
 			add_line_break_to_layout_box(state, dest, box);
-			section_start = pos += 2;
-		} else {
-			++pos;
+			break;
 		}
 	}
+}
+
+} // namespace impl
+
+void add_unparsed_text_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, std::string_view sv, substitution_map const& mp) {
+	if(sv.length() == 0)
+		return;
 
-	if(section_start < seq_end)
-		add_text_range(std::string_view(section_start, seq_end - section_start));
+	// laying out text never comes back here, so one list per thread is enough
+	thread_local std::vector<template_token> tokens;
+	tokens.clear();
+	compile_template(sv, tokens);
+	impl::lb_add_template(state, dest, box, sv, tokens, mp);
 }
 
 void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, dcon::text_key source_text, substitution_map const& mp) {
 	if(!source_text)
 		return;
 
-	std::string_view sv;
-	if(auto it = state.locale_key_to_text_sequence.find(source_text); it != state.locale_key_to_text_sequence.end()) {
-		sv = state.locale_string_view(it->second);
-	} else {
-		sv = state.to_string_view(source_text);
-	}
-	add_unparsed_text_to_layout_box(state, dest, box, sv, mp);
+	std::vector<template_token> scratch;
+	std::span<template_token const> tokens;
+	auto sv = impl::key_template(state, source_text, scratch, tokens);
+	impl::lb_add_template(state, dest, box, sv, tokens, mp);
 }
 
 void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, substitution val, text_color color) {
+	if(number_buffer num; impl::lb_format_numeric_substitution(num, val, state.font_collection.numbers)) {
+		add_to_layout_box(state, dest, box, num.view(), color, val);
+		return;
+	}
 	auto txt = impl::lb_resolve_substitution(state, val, substitution_map{});
 	add_to_layout_box(state, dest, box, std::string_view(txt), color, val);
 }
@@ -1585,6 +1795,11 @@ void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, st
 	add_to_layout_box(state, dest, box, std::string_view(val), color, std::monostate{});
 }
 void add_space_to_layout_box(sys::state& state, layout_base& dest, layout_box& box) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::space, 0);
+	if(dest.digest_only)
+		return;
+
 	auto& font = state.font_collection.get_font(state, text::font_index_from_font_id(state, dest.fixed_parameters.font_id));
 	auto& font_inst = font.retrieve_instance(state, text::size_from_font_id(dest.fixed_parameters.font_id));
 	auto glyphid = FT_Get_Char_Index(font_inst.font_face, ' ');
@@ -1599,6 +1814,8 @@ void add_space_to_layout_box(sys::state& state, layout_base& dest, layout_box& b
 }
 
 layout_box open_layout_box(layout_base& dest, int32_t indent) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::box_open, uint32_t(indent));
 	if(dest.native_rtl == layout_base::rtl_status::ltr)
 		return layout_box{dest.base_layout.contents.size(), dest.base_layout.contents.size(), indent, 0, 0,
 			float(indent + dest.fixed_parameters.left), 0, dest.fixed_parameters.color};
@@ -1607,6 +1824,8 @@ layout_box open_layout_box(layout_base& dest, int32_t indent) {
 			float(dest.fixed_parameters.right - indent), 0, dest.fixed_parameters.color };
 }
 void close_layout_box(columnar_layout& dest, layout_box& box) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::box_close, 0);
 	impl::lb_finish_line(dest, box, 0);
 	if(dest.native_rtl == layout_base::rtl_status::ltr) {
 		if(box.y_size + dest.y_cursor >= dest.fixed_parameters.bottom) { // make new column
@@ -1647,6 +1866,8 @@ void close_layout_box(columnar_layout& dest, layout_box& box) {
 	}
 }
 void close_layout_box(endless_layout& dest, layout_box& box) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::box_close, 0);
 	impl::lb_finish_line(dest, box, 0);
 	for(auto i = box.first_chunk; i < dest.base_layout.contents.size(); ++i) {
 		dest.base_layout.contents[i].y += int16_t(dest.y_cursor);
@@ -1655,6 +1876,8 @@ void close_layout_box(endless_layout& dest, layout_box& box) {
 	dest.y_cursor += box.y_size;
 }
 void close_layout_box(single_line_layout& dest, layout_box& box) {
+	if(dest.content_digest)
+		impl::lb_digest(dest, impl::lb_digest_item::box_close, 0);
 	impl::lb_finish_line(dest, box, 0);
 }
 
@@ -1672,9 +1895,53 @@ void single_line_layout::internal_close_box(layout_box& b) {
 	close_layout_box(*this, b);
 }
 
+void shaped_chunk_cache::begin_pass(sys::state& state, uint16_t for_font_id) {
+	auto current_locale = state.font_collection.get_current_locale();
+	if(for_font_id != font_id || ui_scale != state.user_settings.ui_scale || current_locale != locale) {
+		entries.clear();
+		font_id = for_font_id;
+		ui_scale = state.user_settings.ui_scale;
+		locale = current_locale;
+	}
+	++generation;
+}
+void shaped_chunk_cache::end_pass() {
+	for(auto it = entries.begin(); it != entries.end(); ) {
+		if(it->second.last_used != generation)
+			it = entries.erase(it);
+		else
+			++it;
+	}
+}
+shaped_chunk_cache::entry const* shaped_chunk_cache::find(std::u16string_view chunk_text) {
+	auto it = entries.find(chunk_text);
+	if(it == entries.end()) {
+		++misses;
+		return nullptr;
+	}
+	++hits;
+	it->second.last_used = generation;
+	return &(it->second);
+}
+void shaped_chunk_cache::store(std::u16string_view chunk_text, stored_glyphs const& glyphs, layout_details const& d, size_t first_cluster, uint32_t details_offset) {
+	auto it = entries.find(chunk_text);
+	if(it == entries.end())
+		it = entries.emplace(std::u16string(chunk_text), entry{ }).first;
+	auto& e = it->second;
+	e.glyphs = glyphs;
+	e.clusters.assign(d.grapheme_placement.begin() + first_cluster, d.grapheme_placement.end());
+	for(auto& c : e.clusters) {
+		c.source_offset = uint16_t(c.source_offset - details_offset);
+		if(c.visual_left != -1)
+			c.visual_left = int16_t(c.visual_left - int32_t(first_cluster));
+		if(c.visual_right != -1)
+			c.visual_right = int16_t(c.visual_right - int32_t(first_cluster));
+	}
+	e.last_used = generation;
+}
+
 columnar_layout create_columnar_layout(sys::state& state, layout& dest, layout_parameters const& params, int32_t column_width) {
-	dest.contents.clear();
-	dest.number_of_lines = 0;
+	dest.clear();
 	return columnar_layout(dest, params, state.world.locale_get_native_rtl(state.font_collection.get_current_locale()) ? layout_base::rtl_status::rtl : layout_base::rtl_status::ltr, 0, 0, params.top, column_width);
 }
 
@@ -1907,86 +2174,29 @@ void add_divider_to_layout_box(sys::state& state, layout_base& dest, layout_box&
 std::string resolve_string_substitution(sys::state& state, dcon::text_key source_text, substitution_map const& mp) {
 	std::string result;
 
-	std::string_view sv;
-	if(auto it = state.locale_key_to_text_sequence.find(source_text); it != state.locale_key_to_text_sequence.end()) {
-		sv = state.locale_string_view(it->second);
-	} else {
-		sv = state.to_string_view(source_text);
-	}
-
-	char const* seq_start = sv.data();
-	char const* seq_end = sv.data() + sv.size();
-	char const* section_start = seq_start;
-
-	auto add_text_range = [&](std::string_view sv) {
-		result += sv;
-	};
-
-	for(char const* pos = seq_start; pos < seq_end;) {
-		bool colour_esc = false;
-		if(pos + 1 < seq_end && uint8_t(*pos) == 0xC2 && uint8_t(*(pos + 1)) == 0xA7) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			pos += 2;
-			section_start = pos;
-			if(pos < seq_end) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(pos + 2 < seq_end && uint8_t(*pos) == 0xEF && uint8_t(*(pos + 1)) == 0xBF && uint8_t(*(pos + 2)) == 0xBD && is_qmark_color(*(pos + 3))) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			section_start = pos += 3;
-
-			if(pos < seq_end) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(pos + 1 < seq_end && *pos == '?' && is_qmark_color(*(pos + 1))) {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			pos += 1;
-			section_start = pos;
-
-			if(pos < seq_end) {
-				pos += 1;
-				section_start = pos;
-			}
-		} else if(*pos == '$') {
-			if(section_start < pos)
-				add_text_range(std::string_view(section_start, pos - section_start));
-
-			const char* vend = pos + 1;
-			for(; vend != seq_end && *vend != '$'; ++vend)
-				;
-			if(vend > pos + 1) {
-				auto var_type = variable_type_from_name(std::string_view(pos + 1, vend - pos - 1));
-				if(var_type != variable_type::error_no_matching_value) {
-					if(auto it = mp.find(uint32_t(var_type)); it != mp.end()) {
-						result += impl::lb_resolve_substitution(state, it->second, mp);
-					} else {
-						result += "???";
-					}
-				} else {
-					result += std::string_view(pos, (vend - pos) + 1);
-				}
+	std::vector<template_token> scratch;
+	std::span<template_token const> tokens;
+	auto sv = impl::key_template(state, source_text, scratch, tokens);
+	for(auto& t : tokens) {
+		switch(t.type) {
+		case template_token_type::text:
+		case template_token_type::icon:
+			result += sv.substr(t.start, t.length);
+			break;
+		case template_token_type::variable:
+			if(variable_type(t.value) == variable_type::error_no_matching_value) {
+				result += sv.substr(t.start, t.length);
+			} else if(auto it = mp.find(uint32_t(t.value)); it != mp.end()) {
+				result += impl::lb_resolve_substitution(state, it->second, mp);
+			} else {
+				result += "???";
 			}
-			pos = vend + 1;
-			section_start = pos;
-		} else if(pos + 1 < seq_end && *pos == '\\' && *(pos + 1) == 'n') {
-			add_text_range(std::string_view(section_start, pos - section_start));
-			section_start = pos += 2;
-		} else {
-			++pos;
+			break;
+		case template_token_type::color:
+		case template_token_type::line_break:
+			break;
 		}
 	}
-
-	if(section_start < seq_end)
-		add_text_range(std::string_view(section_start, seq_end - section_start));
-
 	return result;
 }
 
@@ -14,6 +14,9 @@
 namespace sys {
 struct state;
 }
+namespace simple_fs {
+struct file_contents;
+}
 
 namespace text {
 
@@ -623,7 +626,17 @@ inline void mum(uint64_t* a, uint64_t* b) {
 inline bool lazy_ci_eq(std::string_view a, std::string_view b) {
 	if(a.length() != b.length())
 		return false;
-	for(uint32_t i = 0; i < a.length(); ++i) {
+	// compare eight case folded bytes at a time, the same way ci_wyhash reads them
+	size_t i = 0;
+	for(; i + 8 <= a.length(); i += 8) {
+		uint64_t x{};
+		uint64_t y{};
+		std::memcpy(&x, a.data() + i, 8);
+		std::memcpy(&y, b.data() + i, 8);
+		if((x | 0x2020202020202020) != (y | 0x2020202020202020))
+			return false;
+	}
+	for(; i < a.length(); ++i) {
 		if((a[i] | 0x20) != (b[i] | 0x20))
 			return false;
 	}
@@ -632,6 +645,31 @@ inline bool lazy_ci_eq(std::string_view a, std::string_view b) {
 
 }
 
+// keys in key_data are stored as [uint32_t length][uint64_t ci_wyhash][bytes][0], and a text_key is the offset
+// of the first byte, so the length and hash of a key can be read back instead of recomputed
+constexpr size_t key_header_size = sizeof(uint32_t) + sizeof(uint64_t);
+
+inline std::string_view key_string(std::vector<char> const& text_data, dcon::text_key tag) {
+	if(!tag)
+		return std::string_view();
+	uint32_t length = 0;
+	std::memcpy(&length, text_data.data() + tag.index() - key_header_size, sizeof(uint32_t));
+	return std::string_view(text_data.data() + tag.index(), length);
+}
+inline uint64_t key_hash(std::vector<char> const& text_data, dcon::text_key tag) {
+	if(!tag)
+		return detail::ci_wyhash(nullptr, 0);
+	uint64_t hash = 0;
+	std::memcpy(&hash, text_data.data() + tag.index() - sizeof(uint64_t), sizeof(uint64_t));
+	return hash;
+}
+
+// a key that has already been hashed, for looking up or interning without hashing it again
+struct hashed_key {
+	std::string_view text;
+	uint64_t hash = 0;
+};
+
 struct vector_backed_ci_hash {
 	using is_avalanching = void;
 	using is_transparent = void;
@@ -643,20 +681,11 @@ struct vector_backed_ci_hash {
 	auto operator()(std::string_view sv) const noexcept -> uint64_t {
 		return detail::ci_wyhash(sv.data(), sv.size());
 	}
+	auto operator()(hashed_key k) const noexcept -> uint64_t {
+		return k.hash;
+	}
 	auto operator()(dcon::text_key tag) const noexcept -> uint64_t {
-		auto sv = [&]() {
-			if(!tag)
-				return std::string_view();
-			auto start_position = text_data.data() + tag.index();
-			auto data_size = text_data.size();
-			auto end_position = start_position;
-			for(; end_position < text_data.data() + data_size; ++end_position) {
-				if(*end_position == 0)
-					break;
-			}
-			return std::string_view(text_data.data() + tag.index(), size_t(end_position - start_position));
-			}();
-		return detail::ci_wyhash(sv.data(), sv.size());
+		return key_hash(text_data, tag);
 	}
 };
 struct vector_backed_ci_eq {
@@ -670,64 +699,16 @@ struct vector_backed_ci_eq {
 		return l == r;
 	}
 	bool operator()(dcon::text_key l, std::string_view r) const noexcept {
-		auto sv = [&]() {
-			if(!l)
-				return std::string_view();
-			auto start_position = text_data.data() + l.index();
-			auto data_size = text_data.size();
-			auto end_position = start_position;
-			for(; end_position < text_data.data() + data_size; ++end_position) {
-				if(*end_position == 0)
-					break;
-			}
-			return std::string_view(text_data.data() + l.index(), size_t(end_position - start_position));
-			}();
-			return detail::lazy_ci_eq(sv, r);
+		return detail::lazy_ci_eq(key_string(text_data, l), r);
 	}
 	bool operator()(std::string_view r, dcon::text_key l) const noexcept {
-		auto sv = [&]() {
-			if(!l)
-				return std::string_view();
-			auto start_position = text_data.data() + l.index();
-			auto data_size = text_data.size();
-			auto end_position = start_position;
-			for(; end_position < text_data.data() + data_size; ++end_position) {
-				if(*end_position == 0)
-					break;
-			}
-			return std::string_view(text_data.data() + l.index(), size_t(end_position - start_position));
-			}();
-			return detail::lazy_ci_eq(sv, r);
+		return detail::lazy_ci_eq(key_string(text_data, l), r);
 	}
-	bool operator()(dcon::text_key l, std::string const& r) const noexcept {
-		auto sv = [&]() {
-			if(!l)
-				return std::string_view();
-			auto start_position = text_data.data() + l.index();
-			auto data_size = text_data.size();
-			auto end_position = start_position;
-			for(; end_position < text_data.data() + data_size; ++end_position) {
-				if(*end_position == 0)
-					break;
-			}
-			return std::string_view(text_data.data() + l.index(), size_t(end_position - start_position));
-			}();
-			return detail::lazy_ci_eq(sv, r);
+	bool operator()(dcon::text_key l, hashed_key r) const noexcept {
+		return key_hash(text_data, l) == r.hash && detail::lazy_ci_eq(key_string(text_data, l), r.text);
 	}
-	bool operator()(std::string const& r, dcon::text_key l) const noexcept {
-		auto sv = [&]() {
-			if(!l)
-				return std::string_view();
-			auto start_position = text_data.data() + l.index();
-			auto data_size = text_data.size();
-			auto end_position = start_position;
-			for(; end_position < text_data.data() + data_size; ++end_position) {
-				if(*end_position == 0)
-					break;
-			}
-			return std::string_view(text_data.data() + l.index(), size_t(end_position - start_position));
-			}();
-			return detail::lazy_ci_eq(sv, r);
+	bool operator()(hashed_key r, dcon::text_key l) const noexcept {
+		return key_hash(text_data, l) == r.hash && detail::lazy_ci_eq(key_string(text_data, l), r.text);
 	}
 };
 
@@ -766,6 +747,22 @@ using substitution = std::variant<std::string_view, dcon::text_key, int64_t, fp_
 		embedded_icon>;
 using substitution_map = ankerl::unordered_dense::map<uint32_t, substitution>;
 
+// a localization string broken up once into what layout needs from it: literal text, colour switches, icons,
+// substitution slots and line breaks. start and length give the source of the token within the string
+enum class template_token_type : uint8_t {
+	text, color, icon, variable, line_break
+};
+struct template_token {
+	uint32_t start = 0;
+	uint32_t length = 0;
+	template_token_type type = template_token_type::text;
+	uint16_t value = 0; // the text_color, embedded_icon or variable_type (error_no_matching_value for unknown names)
+};
+struct template_range {
+	uint32_t first = 0;
+	uint32_t count = 0;
+};
+
 struct text_chunk {
 	text::stored_glyphs unicodechars;
 	float x = 0; // yes, there is a reason the x offset is a floating point value while the y offset is an integer
@@ -774,6 +771,7 @@ struct text_chunk {
 	int16_t width = 0;
 	int16_t height = 0;
 	text_color color = text_color::black;
+	text_effect effect = text_effect::none;
 };
 struct layout_parameters {
 	int16_t left = 0;
@@ -786,10 +784,52 @@ struct layout_parameters {
 	text_color color = text_color::white;
 	bool suppress_hyperlinks = false;
 	bool single_line = false;
+	text_effect effect = text_effect::none; // given to every chunk of the layout
 };
 struct layout {
 	std::vector<text_chunk> contents;
 	int32_t number_of_lines = 0;
+	// when set, glyphs shaped for this layout are bump allocated from here and released all at once when it is rebuilt
+	std::pmr::monotonic_buffer_resource* transient_memory = nullptr;
+
+	layout() = default;
+	// a copy's glyphs go back to the default heap, so it must not share (and later release) the original's memory
+	layout(layout const& o) : contents(o.contents), number_of_lines(o.number_of_lines) { }
+	// moved glyphs stay where they were shaped, so the memory they live in goes with them
+	layout(layout&& o) noexcept : contents(std::move(o.contents)), number_of_lines(o.number_of_lines), transient_memory(o.transient_memory) {
+		o.contents.clear();
+		o.number_of_lines = 0;
+		o.transient_memory = nullptr;
+	}
+	layout& operator=(layout const& o) {
+		if(this != &o) {
+			contents = o.contents;
+			number_of_lines = o.number_of_lines;
+		}
+		return *this;
+	}
+	layout& operator=(layout&& o) noexcept {
+		if(this != &o) {
+			clear();
+			contents = std::move(o.contents);
+			number_of_lines = o.number_of_lines;
+			transient_memory = o.transient_memory;
+			o.contents.clear();
+			o.number_of_lines = 0;
+			o.transient_memory = nullptr;
+		}
+		return *this;
+	}
+
+	std::pmr::memory_resource* glyph_memory() const {
+		return transient_memory ? static_cast<std::pmr::memory_resource*>(transient_memory) : std::pmr::get_default_resource();
+	}
+	void clear() {
+		contents.clear();
+		number_of_lines = 0;
+		if(transient_memory)
+			transient_memory->release();
+	}
 	text_chunk const* get_chunk_from_position(int32_t x, int32_t y) const;
 };
 
@@ -805,12 +845,53 @@ struct layout_box {
 	text_color color = text_color::white;
 };
 
+// remembers how the chunks of an editable layout were shaped, so that laying out nearly the same text again only
+// shapes the chunks that changed. entries not used by the latest layout are dropped at the end of it
+struct shaped_chunk_cache {
+	struct entry {
+		stored_glyphs glyphs;
+		std::vector<ex_grapheme_cluster_info> clusters; // source offsets and visual links are relative to the chunk
+		uint32_t last_used = 0;
+	};
+	// looked up by view, so that finding a chunk doesn't allocate a string for it
+	struct text_hash {
+		using is_avalanching = void;
+		using is_transparent = void;
+
+		auto operator()(std::u16string_view v) const noexcept -> uint64_t {
+			return ankerl::unordered_dense::hash<std::u16string_view>{}(v);
+		}
+	};
+	struct text_eq {
+		using is_transparent = void;
+
+		bool operator()(std::u16string_view l, std::u16string_view r) const noexcept {
+			return l == r;
+		}
+	};
+	ankerl::unordered_dense::map<std::u16string, entry, text_hash, text_eq> entries;
+	dcon::locale_id locale;
+	float ui_scale = 0.0f;
+	uint16_t font_id = 0;
+	uint32_t generation = 0;
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+	void begin_pass(sys::state& state, uint16_t font_id);
+	void end_pass();
+	entry const* find(std::u16string_view chunk_text);
+	void store(std::u16string_view chunk_text, stored_glyphs const& glyphs, layout_details const& d, size_t first_cluster, uint32_t details_offset);
+};
+
 struct layout_base {
 	enum class rtl_status : uint8_t { ltr, rtl };
 	layout& base_layout;
 	layout_parameters fixed_parameters;
 	rtl_status native_rtl = rtl_status::ltr;
 	layout_details* edit_details = nullptr;
+	shaped_chunk_cache* chunk_cache = nullptr; // only consulted when edit_details is set
+	uint64_t* content_digest = nullptr; // when set, everything added to the layout is also hashed into it
+	bool digest_only = false; // only hash what is added to the layout, without shaping or placing it
 
 	layout_base(layout& base_layout, layout_parameters const& fixed_parameters, rtl_status native_rtl)
 			: base_layout(base_layout), fixed_parameters(fixed_parameters), native_rtl(native_rtl) {
@@ -898,9 +979,30 @@ void add_to_layout_box(sys::state& state, layout_base& dest, layout_box& box, em
 void close_layout_box(layout_base& dest, layout_box& box);
 
 void add_to_substitution_map(substitution_map& mp, variable_type key, substitution value);
+void compile_template(std::string_view sv, std::vector<template_token>& out); // appends the tokens of sv
+void compile_locale_templates(sys::state& state); // tokenizes every string of the loaded locale
 void add_to_substitution_map(substitution_map& mp, variable_type key, std::string const&); // DO NOT USE THIS FUNCTION
 
-void consume_csv_file(sys::state& state, char const* file_content, uint32_t file_size, int32_t target_column);
+// compiled form of the rows read out of a locale's csv files. replaying it produces the same key_data,
+// locale_text_data and locale_key_to_text_sequence as parsing the files would, without touching the csv text
+struct locale_cache_entry {
+	uint32_t key_offset = 0;
+	uint32_t key_length = 0;
+	uint32_t text_offset = 0; // into the text blob, or no_text for an empty value
+	static constexpr uint32_t no_text = 0xFFFFFFFF;
+};
+struct locale_cache_builder {
+	std::vector<locale_cache_entry> entries;
+	std::vector<char> key_bytes;
+	std::vector<char> text_bytes;
+};
+
+void consume_csv_file(sys::state& state, char const* file_content, uint32_t file_size, int32_t target_column, locale_cache_builder* cache = nullptr);
+// tokenizes the files in parallel, then interns the rows in file order
+void consume_csv_files(sys::state& state, std::vector<simple_fs::file_contents> const& files, int32_t target_column, locale_cache_builder* cache = nullptr);
+uint64_t locale_source_hash(uint64_t running_hash, std::string_view file_name, char const* file_content, uint32_t file_size);
+bool load_locale_cache(sys::state& state, std::string_view locale_name, uint64_t source_hash); // false if missing or stale
+void save_locale_cache(sys::state& state, std::string_view locale_name, uint64_t source_hash, locale_cache_builder const& cache);
 variable_type variable_type_from_name(std::string_view);
 char16_t win1250toUTF16(char in);
 std::string produce_simple_string(sys::state const& state, std::string_view key);
@@ -910,8 +1012,22 @@ ui::alignment localized_alignment(sys::state& state, ui::alignment in);
 text::alignment to_text_alignment(ui::alignment in);
 
 dcon::text_key find_or_add_key(sys::state& state, std::string_view key);
+// interns many keys at once, in order, hashing them in parallel first
+void add_keys_utf8(sys::state& state, std::span<std::string_view const> keys, std::span<dcon::text_key> results);
 
 
+// scratch space that numbers are formatted into directly as utf16, without allocating
+struct number_buffer {
+	static constexpr uint32_t capacity = 64;
+	char16_t data[capacity] = { 0 };
+	uint32_t length = 0;
+
+	std::u16string_view view() const {
+		return std::u16string_view(data, length);
+	}
+	std::string to_string() const; // as utf8
+};
+
 std::string prettify(int64_t num);
 std::string prettify_currency(float num);
 std::string prettify_float(float num);
@@ -921,6 +1037,14 @@ std::string format_percentage(float num, size_t digits = 2);
 std::string format_float(float num, size_t digits = 2);
 std::string format_ratio(int32_t left, int32_t right);
 
+// the same formats, written over the contents of the buffer with the given separators
+void prettify(number_buffer& out, int64_t num, number_format const& fmt = number_format{});
+void prettify_currency(number_buffer& out, float num, number_format const& fmt = number_format{});
+void prettify_float(number_buffer& out, float num, number_format const& fmt = number_format{});
+void format_wholenum(number_buffer& out, int32_t num, number_format const& fmt = number_format{});
+void format_percentage(number_buffer& out, float num, size_t digits, number_format const& fmt = number_format{});
+void format_float(number_buffer& out, float num, size_t digits, number_format const& fmt = number_format{});
+
 
 void localised_format_box(sys::state& state, layout_base& dest, layout_box& box, std::string_view key, substitution_map const& sub = substitution_map{});
 void localised_single_sub_box(sys::state& state, layout_base& dest, layout_box& box, std::string_view key, variable_type subkey, substitution value);
@@ -78,6 +78,7 @@ public:
 
 	bool in_fullscreen = false;
 	bool left_mouse_down = false;
+	bool waiting_for_events = false; // the window loop is blocked on events without holding ui_lock
 };
 } // namespace window
 #endif
@@ -114,6 +115,7 @@ enum class cursor_type : uint8_t {
 void change_cursor(sys::state& state, cursor_type type);
 
 void get_window_size(sys::state const& game_state, int& width, int& height);
+void wake_ui_loop(sys::state& game_state); // may be called from any thread to make the window loop check for a new frame
 int32_t cursor_blink_ms();
 int32_t double_click_ms();
 void release_text_services_object(text_services_object* ptr);
@@ -77,6 +77,11 @@ void get_window_size(sys::state const& game_state, int& width, int& height) {
 	glfwGetWindowSize(game_state.win_ptr->window, &width, &height);
 }
 
+void wake_ui_loop(sys::state& game_state) {
+	if(game_state.win_ptr && game_state.win_ptr->window)
+		glfwPostEmptyEvent();
+}
+
 bool is_in_fullscreen(sys::state const& game_state) {
 	return (game_state.win_ptr) && game_state.win_ptr->in_fullscreen;
 }
@@ -131,12 +136,25 @@ sys::key_modifiers get_current_modifiers(int glfw_mods) {
 	return sys::key_modifiers(val);
 }
 
+// callbacks dispatched while the window loop waits on events without ui_lock take it for themselves
+class callback_lock {
+	std::unique_lock<std::mutex> lock;
+public:
+	callback_lock(sys::state& state) {
+		if(state.win_ptr->waiting_for_events) {
+			lock = std::unique_lock<std::mutex>(state.ui_lock);
+			state.ui_lock_cv.wait(lock, [&] { return !state.yield_ui_lock; });
+		}
+	}
+};
+
 static void glfw_error_callback(int error, char const* description) {
 	emit_error_message(std::string{ "Glfw Error " } + std::to_string(error) + std::string{ description }, false);
 }
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 
 	sys::virtual_key virtual_key = glfw_key_to_virtual_key.at(key);
 	switch(action) {
@@ -168,6 +186,7 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 
 static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 
 	int32_t x = (xpos > 0 ? (int32_t)std::round(xpos) : 0);
 	int32_t y = (ypos > 0 ? (int32_t)std::round(ypos) : 0);
@@ -182,6 +201,7 @@ static void cursor_position_callback(GLFWwindow* window, double xpos, double ypo
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 
 	double xpos, ypos;
 	glfwGetCursorPos(window, &xpos, &ypos);
@@ -218,6 +238,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 
 	double xpos, ypos;
 	glfwGetCursorPos(window, &xpos, &ypos);
@@ -231,6 +252,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 
 void character_callback(GLFWwindow* window, unsigned int codepoint) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 	if(state->ui_state.edit_target_internal) {
 		state->on_text(codepoint);
 	}
@@ -238,6 +260,7 @@ void character_callback(GLFWwindow* window, unsigned int codepoint) {
 
 void on_window_change(GLFWwindow* window) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
 
 	window_state t = window_state::normal;
 	if(glfwGetWindowAttrib(window, GLFW_MAXIMIZED) == GLFW_MAXIMIZED)
@@ -270,8 +293,16 @@ void window_maximize_callback(GLFWwindow* window, int maximized) {
 	on_window_change(window);
 }
 
+void window_refresh_callback(GLFWwindow* window) {
+	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
+	state->ui_redraw_requested = true;
+}
+
 void focus_callback(GLFWwindow* window, int focused) {
 	sys::state* state = (sys::state*)glfwGetWindowUserPointer(window);
+	callback_lock guard(*state);
+	state->ui_redraw_requested = true;
 	if(focused) {
 		if(state->user_settings.mute_on_focus_lost) {
 			sound::resume_all(*state);
@@ -321,6 +352,7 @@ void create_window(sys::state& game_state, creation_parameters const& params) {
 	glfwSetWindowMaximizeCallback(window, window_maximize_callback);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetWindowFocusCallback(window, focus_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 	glfwSetWindowSizeLimits(window, 640, 400, 2400, 1800);
 	if(params.borderless_fullscreen){
 		int width, height;
@@ -343,13 +375,24 @@ void create_window(sys::state& game_state, creation_parameters const& params) {
 	change_cursor(game_state, cursor_type::normal);
 
 	while(!glfwWindowShouldClose(window)) {
+		double wait_seconds = 0.0;
 		{
 			std::unique_lock lock(game_state.ui_lock);
 			game_state.ui_lock_cv.wait(lock, [&] { return !game_state.yield_ui_lock; });
 			glfwPollEvents();
 			// Run game code
-			game_state.render();
-			glfwSwapBuffers(window);
+			if(game_state.ui_frame_due()) {
+				game_state.render();
+				glfwSwapBuffers(window);
+			} else {
+				wait_seconds = game_state.ui_idle_wait_seconds();
+			}
+		}
+		if(wait_seconds > 0.0) {
+			// nothing new to draw: sleep until an event arrives, leaving the lock to the update thread meanwhile
+			game_state.win_ptr->waiting_for_events = true;
+			glfwWaitEventsTimeout(wait_seconds);
+			game_state.win_ptr->waiting_for_events = false;
 		}
 
 		sound::update_music_track(game_state);
@@ -39,6 +39,11 @@ void get_window_size(sys::state const& game_state, int& width, int& height) {
 	height = (getRect.bottom - getRect.top);
 }
 
+void wake_ui_loop(sys::state& game_state) {
+	if(game_state.win_ptr && game_state.win_ptr->hwnd)
+		PostMessageW(game_state.win_ptr->hwnd, WM_NULL, 0, 0);
+}
+
 bool is_in_fullscreen(sys::state const& game_state) {
 	return (game_state.win_ptr) && game_state.win_ptr->in_fullscreen;
 }
@@ -425,6 +430,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 	case WM_PAINT:
 	case WM_DISPLAYCHANGE: {
+		state->ui_redraw_requested = true;
 		PAINTSTRUCT ps;
 		BeginPaint(hwnd, &ps);
 		EndPaint(hwnd, &ps);
@@ -552,10 +558,15 @@ void create_window(sys::state& game_state, creation_parameters const& params) {
 			if(game_state.ui_state.edit_target_internal)
 				TranslateMessage(&msg);
 			DispatchMessageW(&msg);
-		} else {
+		} else if(game_state.ui_frame_due()) {
 			// Run game code
 			game_state.render();
 			SwapBuffers(game_state.win_ptr->opengl_window_dc);
+		} else {
+			// nothing new to draw: sleep until a message arrives
+			auto wait_ms = DWORD(game_state.ui_idle_wait_seconds() * 1000.0);
+			lock.unlock();
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, wait_ms, QS_ALLINPUT);
 		}
 	}
 
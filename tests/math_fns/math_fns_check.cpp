@@ -0,0 +1,157 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "math_fns.hpp"
+
+// every lane result has to match the scalar function exactly, since the game state depends on these being the same
+// on every machine whichever version was used
+
+namespace {
+
+uint64_t rng_state = 88172645463325252ull;
+uint32_t next_random() {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return uint32_t(rng_state >> 32);
+}
+float float_from_bits(uint32_t bits) {
+	float f;
+	std::memcpy(&f, &bits, sizeof(float));
+	return f;
+}
+uint32_t bits_of(float f) {
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(float));
+	return bits;
+}
+
+template<typename V, typename LANE_F>
+void run_lanes(std::vector<float> const& in, std::vector<float>& out, LANE_F&& f) {
+	constexpr size_t width = sizeof(V) / sizeof(float);
+	size_t i = 0;
+	for(; i + width <= in.size(); i += width) {
+		V v;
+		std::memcpy(&v, in.data() + i, sizeof(V));
+		V r = f(v);
+		std::memcpy(out.data() + i, &r, sizeof(V));
+	}
+	for(; i < in.size(); ++i) {
+		V v;
+		std::memcpy(&v, in.data() + i - (width - 1), sizeof(V));
+		V r = f(v);
+		std::memcpy(out.data() + i, reinterpret_cast<float const*>(&r) + (width - 1), sizeof(float));
+	}
+}
+
+int32_t failures = 0;
+
+template<typename SCALAR_F>
+void compare(char const* name, char const* version, std::vector<float> const& in, std::vector<float> const& out, SCALAR_F&& f) {
+	size_t mismatches = 0;
+	for(size_t i = 0; i < in.size(); ++i) {
+		auto expected = f(in[i]);
+		if(bits_of(expected) != bits_of(out[i])) {
+			if(mismatches < 5)
+				std::printf("  %s(%.9g) [%08x]: scalar %.9g, %s %.9g\n", name, in[i], bits_of(in[i]), expected, version, out[i]);
+			++mismatches;
+		}
+	}
+	std::printf("%-5s %-6s %zu values, %zu mismatches\n", name, version, in.size(), mismatches);
+	if(mismatches != 0)
+		++failures;
+}
+
+template<typename SCALAR_F, typename SPAN_F, typename LANE_F>
+void check(char const* name, std::vector<float> const& in, SCALAR_F&& scalar, SPAN_F&& spans, LANE_F&& lanes) {
+	std::vector<float> out(in.size());
+	spans(std::span<float const>(in), std::span<float>(out));
+	compare(name, "span", in, out, scalar);
+#ifdef MATH_HAS_LANES4
+	if(in.size() >= 4) {
+		run_lanes<__m128>(in, out, lanes);
+		compare(name, "sse2", in, out, scalar);
+	}
+#endif
+#ifdef MATH_HAS_LANES8
+	if(in.size() >= 8) {
+		run_lanes<__m256>(in, out, lanes);
+		compare(name, "avx2", in, out, scalar);
+	}
+#endif
+}
+
+template<typename F>
+void time(char const* name, std::vector<float>& out, F&& f) {
+	constexpr int32_t runs = 20;
+	auto start = std::chrono::steady_clock::now();
+	for(int32_t r = 0; r < runs; ++r)
+		f();
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	volatile float sink = out[out.size() / 2];
+	(void)sink;
+	std::printf("%-12s %8.1f us per run of %zu values\n", name, double(us) / runs, out.size());
+}
+
+}
+
+int main() {
+	// sin and cos: the range they are used over, magnitudes up to where the reduction falls back to scalar code and
+	// beyond, exact multiples of 2 pi, signed zeros, denormals and any finite bit pattern
+	std::vector<float> angles;
+	float const scales[] = { 1.f, 10.f, 1000.f, 1e6f, 1e9f, 4e9f };
+	for(int32_t i = 0; i < 2000000; ++i)
+		angles.push_back((float(next_random() % 2000001) / 1000000.f - 1.f) * scales[i % 6]);
+	for(int32_t k = -100000; k <= 100000; ++k)
+		angles.push_back(float(k) * (2.f * math::pi));
+	for(float f : { 0.f, -0.f, 1e-40f, -1e-40f, math::pi, -math::pi, math::detail::fmod_lanes_limit, -math::detail::fmod_lanes_limit })
+		angles.push_back(f);
+	for(int32_t i = 0; i < 300000; ++i) {
+		auto f = float_from_bits(next_random());
+		if(std::isfinite(f))
+			angles.push_back(f);
+	}
+	check("sin", angles, [](float x) { return math::sin(x); },
+		[](auto in, auto out) { math::sin(in, out); }, [](auto v) { return math::sin(v); });
+	check("cos", angles, [](float x) { return math::cos(x); },
+		[](auto in, auto out) { math::cos(in, out); }, [](auto v) { return math::cos(v); });
+
+	// acos: its domain, plus the rounding error the scalar version tolerates past either end
+	std::vector<float> cosines;
+	for(int32_t i = 0; i < 3000000; ++i)
+		cosines.push_back(float(int64_t(next_random() % 2002001) - 1001000) / 1000000.f);
+	for(float f : { 1.f, -1.f, 0.f, -0.f })
+		cosines.push_back(f);
+	check("acos", cosines, [](float x) { return math::acos(x); },
+		[](auto in, auto out) { math::acos(in, out); }, [](auto v) { return math::acos(v); });
+
+	// sqrt: every kind of bit pattern, including negatives, infinities and nans
+	std::vector<float> values;
+	for(int32_t i = 0; i < 3000000; ++i)
+		values.push_back(float_from_bits(next_random()));
+	check("sqrt", values, [](float x) { return math::sqrt(x); },
+		[](auto in, auto out) { math::sqrt(in, out); }, [](auto v) { return math::sqrt(v); });
+
+	std::vector<float> in(1 << 20);
+	std::vector<float> out(in.size());
+	for(auto& f : in)
+		f = float(next_random() % 100000) / 1000.f;
+	time("span sin", out, [&]() { math::sin(std::span<float const>(in), std::span<float>(out)); });
+	time("scalar sin", out, [&]() { for(size_t i = 0; i < in.size(); ++i) out[i] = math::sin(in[i]); });
+	time("span cos", out, [&]() { math::cos(std::span<float const>(in), std::span<float>(out)); });
+	time("scalar cos", out, [&]() { for(size_t i = 0; i < in.size(); ++i) out[i] = math::cos(in[i]); });
+	for(auto& f : in)
+		f = float(int32_t(next_random() % 2000001) - 1000000) / 1000000.f;
+	time("span acos", out, [&]() { math::acos(std::span<float const>(in), std::span<float>(out)); });
+	time("scalar acos", out, [&]() { for(size_t i = 0; i < in.size(); ++i) out[i] = math::acos(in[i]); });
+	for(auto& f : in)
+		f = float(next_random() % 100000) / 10.f;
+	time("span sqrt", out, [&]() { math::sqrt(std::span<float const>(in), std::span<float>(out)); });
+	time("scalar sqrt", out, [&]() { for(size_t i = 0; i < in.size(); ++i) out[i] = math::sqrt(in[i]); });
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "system_state.hpp"
+#include "prng.hpp"
+
+// every batch result has to match the single value function exactly, since the game state depends on them being the
+// same on every machine whichever version was used
+
+namespace {
+
+uint64_t rng_state = 88172645463325252ull;
+uint32_t next_random() {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return uint32_t(rng_state >> 32);
+}
+uint32_t bits_of(float f) {
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(float));
+	return bits;
+}
+
+int32_t failures = 0;
+size_t runs = 0;
+
+void report(char const* name, sys::state const& state, uint32_t first, uint32_t lo, size_t count, size_t i) {
+	if(failures < 5)
+		std::printf("  %s: seed %08x, first %08x, lo %08x, length %zu differs at %zu\n", name, state.game_seed, first, lo, count, i);
+	++failures;
+}
+
+void check(sys::state const& state, uint32_t first, uint32_t lo, size_t count) {
+	std::vector<uint64_t> values(count);
+	std::vector<rng::random_pair> pairs(count);
+	std::vector<float> floats(count);
+	rng::get_random_batch(state, first, lo, values);
+	rng::get_random_pair_batch(state, first, lo, pairs);
+	rng::get_random_float_batch(state, first, lo, floats);
+	for(size_t i = 0; i < count; ++i) {
+		auto hi = uint32_t(first + i); // wraps the same way the batches do
+		if(values[i] != rng::get_random(state, hi, lo)) {
+			report("get_random_batch", state, first, lo, count, i);
+			break;
+		}
+		auto p = rng::get_random_pair(state, hi, lo);
+		if(pairs[i].high != p.high || pairs[i].low != p.low) {
+			report("get_random_pair_batch", state, first, lo, count, i);
+			break;
+		}
+		if(bits_of(floats[i]) != bits_of(rng::get_random_float(state, hi, lo))) {
+			report("get_random_float_batch", state, first, lo, count, i);
+			break;
+		}
+	}
+	++runs;
+}
+
+}
+
+int main() {
+	sys::state state;
+	// lengths on both sides of every multiple of the lane widths, starting anywhere, including next to where the counter
+	// wraps around so that a block holds counters from both ends
+	uint32_t const starts[] = { 0u, 1u, 0xFFFFFFFFu, 0xFFFFFFFEu, 0xFFFFFFF9u, 0xFFFFFFF8u, 0xFFFFFFF5u, 0xFFFFFFF0u, 0x7FFFFFFCu, 0x80000000u };
+	for(int32_t seeds = 0; seeds < 20; ++seeds) {
+		state.game_seed = seeds == 0 ? 0u : next_random();
+		for(auto first : starts) {
+			for(size_t count = 0; count <= 40; ++count)
+				check(state, first, next_random(), count);
+		}
+		for(int32_t i = 0; i < 200; ++i)
+			check(state, next_random(), next_random(), size_t(next_random() % 300));
+	}
+
+	std::printf("%zu batches checked, %d mismatches\n", runs, failures);
+	return failures == 0 ? 0 : 1;
+}
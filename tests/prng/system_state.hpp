@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+// prng.cpp only reads the seed from the game state, so the check builds it against this instead of the real one
+namespace sys {
+struct state {
+	uint32_t game_seed = 0;
+};
+}